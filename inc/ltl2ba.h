@@ -19,8 +19,7 @@
 
 /* LTL2BA_EMPTY_SET is passed to make_set() to create empty */
 #define LTL2BA_EMPTY_SET   (-1)
-#define LTL2BA_SET_SIZE(n) (n / (8 * sizeof(int)) + 1)
-#define LTL2BA_Nhash       255
+#define LTL2BA_SET_SIZE(n) ((n) / (8 * sizeof(int)) + 1)
 
 #ifdef __cplusplus
 extern "C" {
@@ -28,9 +27,23 @@ extern "C" {
 
 const char * ltl2ba_version(void);
 
+/* Sets the number of threads mk_generalized() uses to explore an automaton;
+ * 1, the default, keeps to the calling thread. The automata do not depend on
+ * it. Not to be changed while a translation runs. */
+void         ltl2ba_set_threads(int n);
+int          ltl2ba_threads(void);
+
+/* Sets the time in milliseconds mk_generalized() and mk_buchi() each spend at
+ * most on simplifying their automaton before returning it as it is; 0, the
+ * default, simplifies as much as possible. The time is only checked between
+ * rounds of simplification, so the automata then depend on the machine. Not
+ * to be changed while a translation runs. */
+void         ltl2ba_set_simp_budget(int ms);
+int          ltl2ba_simp_budget(void);
+
 typedef struct ltl2ba_Symbol {
 	char *name;
-	struct ltl2ba_Symbol *next; /* linked list, symbol table */
+	int id; /* dense index, in order of interning into the symbol table */
 } ltl2ba_Symbol;
 
 typedef struct ltl2ba_Node {
@@ -107,11 +120,21 @@ enum {
 	LTL2BA_NEXT,       /* 269 */
 };
 
-typedef ltl2ba_Symbol *ltl2ba_Symtab[LTL2BA_Nhash + 1];
+/* Symbols are interned into an open-addressing hash table which grows as
+ * needed. A zero-initialized ltl2ba_Symtab is a valid empty table. */
+typedef struct {
+	ltl2ba_Symbol **slots; /* 'size' slots, NULL if free */
+	int size;              /* 0 or a power of 2 */
+	int count;             /* number of symbols interned so far */
+} ltl2ba_Symtab[1];
 
+/* The distinct C expressions {...} of a formula, indexed by a hash table which
+ * grows as needed. A zero-initialized ltl2ba_Cexprtab is a valid empty table. */
 typedef struct {
-	int cexpr_idx;
-	char *cexpr_expr_table[256];
+	int cexpr_idx;           /* number of C expressions */
+	char **cexpr_expr_table; /* C expression by index */
+	int *cexpr_slots;        /* 'cexpr_size' slots: index + 1, 0 if free */
+	int cexpr_size;          /* 0 or a power of 2 */
 } ltl2ba_Cexprtab;
 
 typedef struct {
@@ -128,14 +151,19 @@ typedef enum {
 	LTL2BA_SIMP_SCC  = 1 << 4, /* use scc simplification */
 	LTL2BA_FJTOFJ    = 1 << 5, /* 2eme fj */
 	LTL2BA_VERBOSE   = 1 << 6,
+	LTL2BA_LAZY      = 1 << 7, /* build alternating transitions on demand */
+	LTL2BA_SIMP_BISIM = 1 << 8, /* merge bisimilar Buchi states */
+	LTL2BA_SIMP_SIM  = 1 << 9, /* reduce the Buchi automaton by simulation */
 } ltl2ba_Flags;
 
 typedef struct {
-	int sym_size;  /* LTL2BA_SET_SIZE() of an upper bound on the number of
+	int sym_size;  /* LTL2BA_SET_SIZE() of the number of distinct
 	                  predicates */
 	int node_size; /* LTL2BA_SET_SIZE() of the number of states */
 } ltl2ba_set_sizes;
 
+struct ltl2ba_lazy;
+
 typedef struct {
 	ltl2ba_ATrans **transition;
 	int *final_set;
@@ -143,6 +171,8 @@ typedef struct {
 	int sym_id;  /* number of symbols */
 	const char **sym_table;
 	ltl2ba_set_sizes sz;
+	struct ltl2ba_lazy *lazy; /* with LTL2BA_LAZY: the states whose
+	                             transitions are not built yet */
 } ltl2ba_Alternating;
 
 typedef struct {
@@ -167,6 +197,7 @@ ltl2ba_Node *  right_linked(ltl2ba_Node *);
 ltl2ba_Node *  tl_nn(int, ltl2ba_Node *, ltl2ba_Node *);
 
 ltl2ba_Symbol *tl_lookup(ltl2ba_Symtab symtab, const char *);
+void           free_cexprtab(ltl2ba_Cexprtab *cexpr);
 
 int            isequal(const ltl2ba_Node *, const ltl2ba_Node *);
 
@@ -180,14 +211,46 @@ void           free_atrans(ltl2ba_ATrans *, int);
 void           free_all_atrans();
 ltl2ba_GTrans *emalloc_gtrans(int sym_size, int node_size);
 void           free_gtrans(ltl2ba_GTrans *, ltl2ba_GTrans *, int);
+void           free_all_gtrans();
 ltl2ba_BTrans *emalloc_btrans(int sym_size);
 void           free_btrans(ltl2ba_BTrans *, ltl2ba_BTrans *, int);
+void           free_all_btrans();
 void           releasenode(int, ltl2ba_Node *);
 void           tfree(void *);
 
 ltl2ba_Node *  tl_parse(ltl2ba_Symtab symtab, ltl2ba_Cexprtab *cexpr,
                         ltl2ba_Flags flags);
 
+/* Build formulas directly, applying the same simplifications as tl_parse()
+ * under 'flags'. The operands are consumed and must not be shared. */
+ltl2ba_Node *  ltl2ba_mk_true(void);
+ltl2ba_Node *  ltl2ba_mk_false(void);
+ltl2ba_Node *  ltl2ba_mk_pred(ltl2ba_Symtab symtab, const char *name);
+ltl2ba_Node *  ltl2ba_mk_cexpr(ltl2ba_Symtab symtab, ltl2ba_Cexprtab *cexpr,
+                               const char *expr);
+ltl2ba_Node *  ltl2ba_mk_not(ltl2ba_Symtab symtab, ltl2ba_Flags flags,
+                             ltl2ba_Node *);
+ltl2ba_Node *  ltl2ba_mk_next(ltl2ba_Symtab symtab, ltl2ba_Flags flags,
+                              ltl2ba_Node *);
+ltl2ba_Node *  ltl2ba_mk_always(ltl2ba_Symtab symtab, ltl2ba_Flags flags,
+                                ltl2ba_Node *);
+ltl2ba_Node *  ltl2ba_mk_eventually(ltl2ba_Symtab symtab, ltl2ba_Flags flags,
+                                    ltl2ba_Node *);
+ltl2ba_Node *  ltl2ba_mk_and(ltl2ba_Symtab symtab, ltl2ba_Flags flags,
+                             ltl2ba_Node *, ltl2ba_Node *);
+ltl2ba_Node *  ltl2ba_mk_or(ltl2ba_Symtab symtab, ltl2ba_Flags flags,
+                            ltl2ba_Node *, ltl2ba_Node *);
+ltl2ba_Node *  ltl2ba_mk_implies(ltl2ba_Symtab symtab, ltl2ba_Flags flags,
+                                 ltl2ba_Node *, ltl2ba_Node *);
+ltl2ba_Node *  ltl2ba_mk_equiv(ltl2ba_Symtab symtab, ltl2ba_Flags flags,
+                               ltl2ba_Node *, ltl2ba_Node *);
+ltl2ba_Node *  ltl2ba_mk_until(ltl2ba_Symtab symtab, ltl2ba_Flags flags,
+                               ltl2ba_Node *, ltl2ba_Node *);
+ltl2ba_Node *  ltl2ba_mk_release(ltl2ba_Symtab symtab, ltl2ba_Flags flags,
+                                 ltl2ba_Node *, ltl2ba_Node *);
+
+/* With LTL2BA_LAZY, the transitions of a state are built when
+ * mk_generalized() first needs them: the formula must be kept until then. */
 ltl2ba_Alternating mk_alternating(const ltl2ba_Node *, FILE *,
                                   const ltl2ba_Cexprtab *cexpr,
                                   ltl2ba_Flags flags);
@@ -198,6 +261,10 @@ ltl2ba_Buchi mk_buchi(ltl2ba_Generalized *g, FILE *, ltl2ba_Flags,
                       const char *const *sym_table,
                       const ltl2ba_Cexprtab *cexpr);
 
+void free_alternating(ltl2ba_Alternating *alt); /* but not its sym_table */
+void free_generalized(ltl2ba_Generalized *g);
+void free_buchi(ltl2ba_Buchi *b);
+
 void print_c_buchi(FILE *f, const ltl2ba_Buchi *b, const char *const *sym_table,
                    const ltl2ba_Cexprtab *cexpr, int sym_id,
                    const char *c_sym_name_prefix, const char *extern_header,
@@ -230,8 +297,10 @@ void c_print_set(FILE *f, const char *const *sym_table, int *pos, int *neg,
                  int sym_size);
 void print_set(FILE *, int *, int);
 int  empty_set(int *, int);
+int  card_set(int *, int);
 int  empty_intersect_sets(int *, int *, int);
 int  same_sets(int *, int *, int);
+unsigned hash_set(int *, int);
 int  included_set(int *, int *, int);
 int  in_set(int *, int);
 int *list_set(int *, int);
@@ -16,7 +16,39 @@ struct counts {
   int astate_count, atrans_count;
 };
 
-static ATrans *build_alternating(const Node *p, const Node **label,
+/* hash of a subformula, consistent with isequal() */
+struct nhash {
+  const Node *node;
+  unsigned h;
+  unsigned lo, hi; /* AND, OR: least and greatest hash of the operands of
+                    * the flattened conjunction resp. disjunction */
+};
+
+struct astate {
+  int id;          /* 0 if free */
+  unsigned h;
+};
+
+struct abuild {
+  const Node **label;     /* subformula of each state */
+  int *sym_map;           /* symbol id -> index in sym_table, -1 if none yet */
+  struct nhash *hashes;   /* 'n_hashes' slots, keyed by node pointer */
+  struct astate *states;  /* 'n_states' slots, keyed by nhash.h */
+  int n_hashes, n_states; /* powers of 2 */
+  ATrans **trans;         /* transitions of each state, as built */
+  int *built;             /* lazy: the states in 'trans', NULL if eager */
+};
+
+/* a lazy automaton: all states are numbered, their transitions are built and
+ * simplified on demand */
+struct ltl2ba_lazy {
+  struct abuild ab;
+  int *ready;             /* the states whose alt->transition is set */
+  Flags flags;
+  struct counts c;
+};
+
+static ATrans *build_alternating(const Node *p, struct abuild *ab,
                                  Alternating *alt);
 
 /********************************************************************\
@@ -40,22 +72,25 @@ static int calculate_node_size(const Node *p)
   }
 }
 
-/* returns the number of predicates */
-static int calculate_sym_size(const Node *p)
+/* returns the largest symbol id of the predicates in p, -1 if there are none */
+static int calculate_max_sym_id(const Node *p)
 {
+  int l, r;
   switch(p->ntyp) {
   case AND:
   case OR:
   case U_OPER:
   case V_OPER:
-    return(calculate_sym_size(p->lft) + calculate_sym_size(p->rgt));
+    l = calculate_max_sym_id(p->lft);
+    r = calculate_max_sym_id(p->rgt);
+    return l > r ? l : r;
   case NEXT:
-    return(calculate_sym_size(p->lft));
   case NOT:
+    return calculate_max_sym_id(p->lft);
   case PREDICATE:
-    return 1;
+    return p->sym->id;
   default:
-    return 0;
+    return -1;
   }
 }
 
@@ -71,6 +106,31 @@ static ATrans *dup_trans(const set_sizes *sz, const ATrans *trans)
   return result;
 }
 
+/* returns a copy of the list of transitions in one block: the transitions,
+ * then their sets, lie contiguously in the order of the list */
+static ATrans *flat_trans(const set_sizes *sz, const ATrans *list)
+{
+  const ATrans *t;
+  ATrans *flat;
+  int n = 0, i, *sets, w = sz->node_size + 2 * sz->sym_size;
+
+  for(t = list; t; t = t->nxt)
+    n++;
+  if(!n) return NULL;
+  flat = tl_emalloc(n * (sizeof(ATrans) + w * sizeof(int)));
+  sets = (int *)(flat + n);
+  for(t = list, i = 0; t; t = t->nxt, i++, sets += w) {
+    flat[i].to  = sets;
+    flat[i].pos = sets + sz->node_size;
+    flat[i].neg = sets + sz->node_size + sz->sym_size;
+    copy_set(t->to,  flat[i].to,  sz->node_size);
+    copy_set(t->pos, flat[i].pos, sz->sym_size);
+    copy_set(t->neg, flat[i].neg, sz->sym_size);
+    flat[i].nxt = i + 1 < n ? &flat[i + 1] : (ATrans *)0;
+  }
+  return flat;
+}
+
 void do_merge_trans(const set_sizes *sz, ATrans **result,
                     const ATrans *trans1, const ATrans *trans2)
 { /* merges two transitions */
@@ -99,29 +159,149 @@ ATrans *merge_trans(const set_sizes *sz, const ATrans *trans1,
   return result;
 }
 
+static unsigned mix(unsigned h, unsigned v)
+{
+  return h ^ (v + 0x9e3779b9u + (h << 6) + (h >> 2));
+}
+
+/* returns the hash of p; AND and OR are hashed by the least and the greatest
+ * hash of their operands, as isequal() ignores their order and repetitions */
+static const struct nhash *node_hash(const Node *p, struct abuild *ab)
+{
+  unsigned mask = ab->n_hashes - 1, lo, hi;
+  unsigned i = (unsigned)(((uintptr_t)p >> 4) * 0x9e3779b9u) & mask;
+  struct nhash n = { p, p->ntyp, 0, 0 };
+  const Node *op[2] = { p->lft, p->rgt };
+  int k;
+
+  for(; ab->hashes[i].node; i = (i + 1) & mask)
+    if(ab->hashes[i].node == p)
+      return &ab->hashes[i];
+
+  switch(p->ntyp) {
+  case PREDICATE:
+    n.h = mix(n.h, p->sym->id);
+    break;
+  case NOT:
+  case NEXT:
+    n.h = mix(n.h, node_hash(p->lft, ab)->h);
+    break;
+  case U_OPER:
+  case V_OPER:
+    n.h = mix(n.h, node_hash(p->lft, ab)->h);
+    n.h = mix(n.h, node_hash(p->rgt, ab)->h);
+    break;
+  case AND:
+  case OR:
+    for(k = 0; k < 2; k++) {
+      const struct nhash *c = node_hash(op[k], ab);
+      lo = op[k]->ntyp == p->ntyp ? c->lo : c->h;
+      hi = op[k]->ntyp == p->ntyp ? c->hi : c->h;
+      if(!k || lo < n.lo) n.lo = lo;
+      if(!k || hi > n.hi) n.hi = hi;
+    }
+    n.h = mix(mix(n.h, n.lo), n.hi);
+    break;
+  }
+
+  /* the recursion above may have taken slot i */
+  while(ab->hashes[i].node)
+    i = (i + 1) & mask;
+  ab->hashes[i] = n;
+  return &ab->hashes[i];
+}
+
 /* finds the id of the node, if already explored */
-static int already_done(const Node *p, const Node *const *label, int node_id)
+static int already_done(const Node *p, struct abuild *ab)
 {
-  int i;
-  for(i = 1; i<node_id; i++)
-    if (isequal(p, label[i]))
-      return i;
+  unsigned mask = ab->n_states - 1, h = node_hash(p, ab)->h, i;
+  /* states with the same hash are met in the order of their ids */
+  for(i = h & mask; ab->states[i].id; i = (i + 1) & mask)
+    if(ab->states[i].h == h && isequal(p, ab->label[ab->states[i].id]))
+      return ab->states[i].id;
   return -1;
 }
 
+/* records that state 'id' is the subformula p */
+static void add_state(const Node *p, int id, struct abuild *ab)
+{
+  unsigned mask = ab->n_states - 1, h = node_hash(p, ab)->h, i;
+  for(i = h & mask; ab->states[i].id; i = (i + 1) & mask);
+  ab->states[i].id = id;
+  ab->states[i].h = h;
+  ab->label[id] = p;
+}
+
+static void number_build(const Node *p, struct abuild *ab, int *n_states,
+                         int *n_syms);
+
+/* numbers the states and predicates boolean() would create for p */
+static void number_boolean(const Node *p, struct abuild *ab, int *n_states,
+                           int *n_syms)
+{
+  switch(p->ntyp) {
+  case TRUE:
+  case FALSE:
+    break;
+  case AND:
+  case OR:
+    number_boolean(p->lft, ab, n_states, n_syms);
+    number_boolean(p->rgt, ab, n_states, n_syms);
+    break;
+  default:
+    number_build(p, ab, n_states, n_syms);
+  }
+}
+
+/* numbers the distinct states and predicates build_alternating() would create
+ * for p at most, in the order it meets them: like it, identifies equal
+ * subformulas by already_done() */
+static void number_build(const Node *p, struct abuild *ab, int *n_states,
+                         int *n_syms)
+{
+  const Symbol *sym = NULL;
+
+  if(already_done(p, ab) >= 0) return;
+
+  switch(p->ntyp) {
+  case PREDICATE:
+    sym = p->sym;
+    break;
+  case NOT:
+    sym = p->lft->sym;
+    break;
+  case NEXT:
+    number_boolean(p->lft, ab, n_states, n_syms);
+    break;
+  case U_OPER:
+  case V_OPER:
+    number_build(p->rgt, ab, n_states, n_syms);
+    number_build(p->lft, ab, n_states, n_syms);
+    break;
+  case AND:
+  case OR:
+    number_build(p->lft, ab, n_states, n_syms);
+    number_build(p->rgt, ab, n_states, n_syms);
+    break;
+  }
+  if(sym && ab->sym_map[sym->id] == -1)
+    ab->sym_map[sym->id] = (*n_syms)++;
+  add_state(p, ++*n_states, ab);
+}
+
 /* finds the id of a predicate, or attributes one */
-static int get_sym_id(const char *s, Alternating *alt)
+static int get_sym_id(const Symbol *s, struct abuild *ab, Alternating *alt)
 {
-  int i;
-  for(i=0; i<alt->sym_id; i++)
-    if (!strcmp(s, alt->sym_table[i]))
-      return i;
-  alt->sym_table[alt->sym_id] = s;
-  return alt->sym_id++;
+  int *id = &ab->sym_map[s->id];
+  if(*id < 0) {
+    alt->sym_table[alt->sym_id] = s->name;
+    *id = alt->sym_id++;
+  }
+  return *id;
 }
 
 /* computes the transitions to boolean nodes -> next & init */
-static ATrans *boolean(const Node *p, const Node **label, Alternating *alt)
+static ATrans *boolean(const Node *p, struct abuild *ab, Alternating *alt)
 {
   ATrans *t1, *t2, *lft, *rgt, *result = (ATrans *)0;
   switch(p->ntyp) {
@@ -133,8 +313,8 @@ static ATrans *boolean(const Node *p, const Node **label, Alternating *alt)
   case FALSE:
     break;
   case AND:
-    lft = boolean(p->lft, label, alt);
-    rgt = boolean(p->rgt, label, alt);
+    lft = boolean(p->lft, ab, alt);
+    rgt = boolean(p->rgt, ab, alt);
     for(t1 = lft; t1; t1 = t1->nxt) {
       for(t2 = rgt; t2; t2 = t2->nxt) {
 	ATrans *tmp = merge_trans(&alt->sz, t1, t2);
@@ -148,14 +328,14 @@ static ATrans *boolean(const Node *p, const Node **label, Alternating *alt)
     free_atrans(rgt, 1);
     break;
   case OR:
-    lft = boolean(p->lft, label, alt);
+    lft = boolean(p->lft, ab, alt);
     for(t1 = lft; t1; t1 = t1->nxt) {
       ATrans *tmp = dup_trans(&alt->sz, t1);
       tmp->nxt = result;
       result = tmp;
     }
     free_atrans(lft, 1);
-    rgt = boolean(p->rgt, label, alt);
+    rgt = boolean(p->rgt, ab, alt);
     for(t1 = rgt; t1; t1 = t1->nxt) {
       ATrans *tmp = dup_trans(&alt->sz, t1);
       tmp->nxt = result;
@@ -164,23 +344,25 @@ static ATrans *boolean(const Node *p, const Node **label, Alternating *alt)
     free_atrans(rgt, 1);
     break;
   default:
-    build_alternating(p, label, alt);
+    if(!ab->built) /* if lazy, p is built on demand */
+      build_alternating(p, ab, alt);
     result = emalloc_atrans(alt->sz.sym_size, alt->sz.node_size);
     clear_set(result->to,  alt->sz.node_size);
     clear_set(result->pos, alt->sz.sym_size);
     clear_set(result->neg, alt->sz.sym_size);
-    add_set(result->to, already_done(p, label, alt->node_id));
+    add_set(result->to, already_done(p, ab));
   }
   return result;
 }
 
 /* builds an alternating automaton for p */
-static ATrans *build_alternating(const Node *p, const Node **label,
+static ATrans *build_alternating(const Node *p, struct abuild *ab,
                                  Alternating *alt)
 {
   ATrans *t1, *t2, *t = (ATrans *)0;
-  int node = already_done(p, label, alt->node_id);
-  if(node >= 0) return alt->transition[node];
+  int node = already_done(p, ab);
+  if(node >= 0 && (!ab->built || in_set(ab->built, node)))
+    return ab->trans[node];
 
   switch (p->ntyp) {
 
@@ -197,7 +379,7 @@ static ATrans *build_alternating(const Node *p, const Node **label,
     clear_set(t->to,  alt->sz.node_size);
     clear_set(t->pos, alt->sz.sym_size);
     clear_set(t->neg, alt->sz.sym_size);
-    add_set(t->pos, get_sym_id(p->sym->name, alt));
+    add_set(t->pos, get_sym_id(p->sym, ab, alt));
     break;
 
   case NOT:
@@ -205,33 +387,35 @@ static ATrans *build_alternating(const Node *p, const Node **label,
     clear_set(t->to,  alt->sz.node_size);
     clear_set(t->pos, alt->sz.sym_size);
     clear_set(t->neg, alt->sz.sym_size);
-    add_set(t->neg, get_sym_id(p->lft->sym->name, alt));
+    add_set(t->neg, get_sym_id(p->lft->sym, ab, alt));
     break;
 
   case NEXT:
-    t = boolean(p->lft, label, alt);
+    t = boolean(p->lft, ab, alt);
     break;
 
   case U_OPER:    /* p U q <-> q || (p && X (p U q)) */
-    for(t2 = build_alternating(p->rgt, label, alt); t2; t2 = t2->nxt) {
+    for(t2 = build_alternating(p->rgt, ab, alt); t2; t2 = t2->nxt) {
       ATrans *tmp = dup_trans(&alt->sz, t2);  /* q */
       tmp->nxt = t;
       t = tmp;
     }
-    for(t1 = build_alternating(p->lft, label, alt); t1; t1 = t1->nxt) {
+    t1 = build_alternating(p->lft, ab, alt);
+    if(node < 0) node = alt->node_id; /* numbered after its operands */
+    for(; t1; t1 = t1->nxt) {
       ATrans *tmp = dup_trans(&alt->sz, t1);  /* p */
-      add_set(tmp->to, alt->node_id);  /* X (p U q) */
+      add_set(tmp->to, node);  /* X (p U q) */
       tmp->nxt = t;
       t = tmp;
     }
-    add_set(alt->final_set, alt->node_id);
+    add_set(alt->final_set, node);
     break;
 
   case V_OPER:    /* p V q <-> (p && q) || (p && X (p V q)) */
-    for(t1 = build_alternating(p->rgt, label, alt); t1; t1 = t1->nxt) {
+    for(t1 = build_alternating(p->rgt, ab, alt); t1; t1 = t1->nxt) {
       ATrans *tmp;
 
-      for(t2 = build_alternating(p->lft, label, alt); t2; t2 = t2->nxt) {
+      for(t2 = build_alternating(p->lft, ab, alt); t2; t2 = t2->nxt) {
 	tmp = merge_trans(&alt->sz, t1, t2);  /* p && q */
 	if(tmp) {
 	  tmp->nxt = t;
@@ -239,8 +423,9 @@ static ATrans *build_alternating(const Node *p, const Node **label,
 	}
       }
 
+      if(node < 0) node = alt->node_id;
       tmp = dup_trans(&alt->sz, t1);  /* p */
-      add_set(tmp->to, alt->node_id);  /* X (p V q) */
+      add_set(tmp->to, node);  /* X (p V q) */
       tmp->nxt = t;
       t = tmp;
     }
@@ -248,8 +433,8 @@ static ATrans *build_alternating(const Node *p, const Node **label,
 
   case AND:
     t = (ATrans *)0;
-    for(t1 = build_alternating(p->lft, label, alt); t1; t1 = t1->nxt) {
-      for(t2 = build_alternating(p->rgt, label, alt); t2; t2 = t2->nxt) {
+    for(t1 = build_alternating(p->lft, ab, alt); t1; t1 = t1->nxt) {
+      for(t2 = build_alternating(p->rgt, ab, alt); t2; t2 = t2->nxt) {
 	ATrans *tmp = merge_trans(&alt->sz, t1, t2);
 	if(tmp) {
 	  tmp->nxt = t;
@@ -261,12 +446,12 @@ static ATrans *build_alternating(const Node *p, const Node **label,
 
   case OR:
     t = (ATrans *)0;
-    for(t1 = build_alternating(p->lft, label, alt); t1; t1 = t1->nxt) {
+    for(t1 = build_alternating(p->lft, ab, alt); t1; t1 = t1->nxt) {
       ATrans *tmp = dup_trans(&alt->sz, t1);
       tmp->nxt = t;
       t = tmp;
     }
-    for(t1 = build_alternating(p->rgt, label, alt); t1; t1 = t1->nxt) {
+    for(t1 = build_alternating(p->rgt, ab, alt); t1; t1 = t1->nxt) {
       ATrans *tmp = dup_trans(&alt->sz, t1);
       tmp->nxt = t;
       t = tmp;
@@ -277,8 +462,13 @@ static ATrans *build_alternating(const Node *p, const Node **label,
     break;
   }
 
-  alt->transition[alt->node_id] = t;
-  label[alt->node_id++] = p;
+  if(ab->built)
+    add_set(ab->built, node);
+  else {
+    node = alt->node_id++;
+    add_state(p, node, ab);
+  }
+  ab->trans[node] = t;
   return(t);
 }
 
@@ -286,36 +476,82 @@ static ATrans *build_alternating(const Node *p, const Node **label,
 |*        Simplification of the alternating automaton               *|
 \********************************************************************/
 
-/* simplifies the transitions */
+/* a transition of a state with the cardinalities of its sets */
+struct wtrans {
+  ATrans *t;
+  int idx;                /* position in the list of transitions */
+  int n_to, n_pos, n_neg;
+};
+
+/* orders by increasing number of elements, later transitions first */
+static int wtrans_cmp(const void *a, const void *b)
+{
+  const struct wtrans *x = a, *y = b;
+  int wx = x->n_to + x->n_pos + x->n_neg;
+  int wy = y->n_to + y->n_pos + y->n_neg;
+  if(wx != wy) return wx < wy ? -1 : 1;
+  return y->idx - x->idx;
+}
+
+/* simplifies the transitions: removes those which include another one; of
+ * identical transitions the last one is kept */
 static void simplify_atrans(const Alternating *alt, ATrans **trans,
                             struct counts *c)
 {
-  ATrans *t, *father = (ATrans *)0;
-  for(t = *trans; t;) {
-    ATrans *t1;
-    for(t1 = *trans; t1; t1 = t1->nxt) {
-      if((t1 != t) &&
-	 included_set(t1->to,  t->to,  alt->sz.node_size) &&
-	 included_set(t1->pos, t->pos, alt->sz.sym_size) &&
-	 included_set(t1->neg, t->neg, alt->sz.sym_size))
-	break;
-    }
-    if(t1) {
-      if (father)
-	father->nxt = t->nxt;
-      else
-	*trans = t->nxt;
+  ATrans *t, **order;
+  struct wtrans *w;
+  int n = 0, i, j, k;
+
+  for(t = *trans; t; t = t->nxt)
+    n++;
+  if(n < 2) {
+    c->atrans_count += n;
+    return;
+  }
+
+  w = tl_emalloc(n * sizeof(*w));
+  order = tl_emalloc(n * sizeof(*order));
+  for(t = *trans, i = 0; t; t = t->nxt, i++) {
+    w[i].t = order[i] = t;
+    w[i].idx = i;
+    w[i].n_to  = card_set(t->to,  alt->sz.node_size);
+    w[i].n_pos = card_set(t->pos, alt->sz.sym_size);
+    w[i].n_neg = card_set(t->neg, alt->sz.sym_size);
+  }
+  qsort(w, n, sizeof(*w), wtrans_cmp);
+
+  /* a transition can only include those before it in w; w[0..k) is the
+   * antichain of the transitions kept so far */
+  for(i = k = 0; i < n; i++) {
+    for(j = 0; j < k; j++)
+      if(w[j].n_to  <= w[i].n_to  &&
+         w[j].n_pos <= w[i].n_pos &&
+         w[j].n_neg <= w[i].n_neg &&
+         included_set(w[j].t->to,  w[i].t->to,  alt->sz.node_size) &&
+         included_set(w[j].t->pos, w[i].t->pos, alt->sz.sym_size) &&
+         included_set(w[j].t->neg, w[i].t->neg, alt->sz.sym_size))
+        break;
+    if(j < k)
+      order[w[i].idx] = NULL;
+    else
+      w[k++] = w[i];
+  }
+
+  /* the list is still linked, keep the order of its transitions */
+  for(t = *trans, i = 0; t; i++) {
+    ATrans *nxt = t->nxt;
+    if(order[i]) {
+      *trans = t;
+      trans = &t->nxt;
+      c->atrans_count++;
+    } else
       free_atrans(t, 0);
-      if (father)
-	t = father->nxt;
-      else
-	t = *trans;
-      continue;
-    }
-    c->atrans_count++;
-    father = t;
-    t = t->nxt;
+    t = nxt;
   }
+  *trans = (ATrans *)0;
+
+  tfree(w);
+  tfree(order);
 }
 
 /* simplifies the alternating automaton */
@@ -344,6 +580,48 @@ static void simplify_astates(const Node **label, Alternating *alt,
   tfree(acc);
 }
 
+/********************************************************************\
+|*           Construction of the transitions on demand              *|
+\********************************************************************/
+
+/* builds the transitions of state i, if not done yet, and simplifies them */
+ATrans *lazy_atrans(const Alternating *alt, int i)
+{
+  struct ltl2ba_lazy *lz = alt->lazy;
+  ATrans *t, *t1, **last;
+
+  if(in_set(lz->ready, i)) return alt->transition[i];
+
+  /* only the sets pointed to by alt change */
+  build_alternating(lz->ab.label[i], &lz->ab, (Alternating *)alt);
+  add_set(lz->ready, i);
+  lz->c.astate_count++;
+  if(!(lz->flags & LTL2BA_SIMP_DIFF)) {
+    for(t = lz->ab.trans[i]; t; t = t->nxt)
+      lz->c.atrans_count++;
+    return alt->transition[i] = flat_trans(&alt->sz, lz->ab.trans[i]);
+  }
+
+  /* the transitions as built are kept for the states built from this one */
+  last = &t;
+  for(t1 = lz->ab.trans[i]; t1; t1 = t1->nxt) {
+    *last = dup_trans(&alt->sz, t1);
+    last = &(*last)->nxt;
+  }
+  *last = (ATrans *)0;
+  simplify_atrans(alt, &t, &lz->c);
+  alt->transition[i] = flat_trans(&alt->sz, t);
+  free_atrans(t, 1);
+  return alt->transition[i];
+}
+
+/* reports the states built on demand so far */
+void lazy_stats(FILE *f, const Alternating *alt)
+{
+  fprintf(f, "%i alternating states, %i transitions built on demand\n",
+          alt->lazy->c.astate_count, alt->lazy->c.atrans_count);
+}
+
 /********************************************************************\
 |*            Display of the alternating automaton                  *|
 \********************************************************************/
@@ -397,31 +675,79 @@ Alternating mk_alternating(const Node *p, FILE *tl_out, const Cexprtab *cexpr,
   memset(&alt, 0, sizeof(alt));
   alt.node_id = 1;
   alt.sym_id = 0;
+  struct abuild ab;
+  int i, max_sym_id = calculate_max_sym_id(p);
+  int n_states = 0, n_syms = 0;
 
+  if(flags & LTL2BA_VERBOSE) flags &= ~LTL2BA_LAZY; /* all states are shown */
   if(flags & LTL2BA_STATS) getrusage(RUSAGE_SELF, &tr_debut);
 
-  int the_node_size = calculate_node_size(p) + 1; /* number of states in the automaton */
-  const Node **label = tl_emalloc(the_node_size * sizeof(Node *));
-  alt.transition = (ATrans **) tl_emalloc(the_node_size * sizeof(ATrans *));
-  alt.sz.node_size = LTL2BA_SET_SIZE(the_node_size);
+  int the_node_size = calculate_node_size(p) + 1; /* bound on the number of states */
+  ab.label = tl_emalloc(the_node_size * sizeof(Node *));
+  /* at most the_node_size states and twice as many nodes: a NOT was counted
+   * without its predicate */
+  for(ab.n_states = 1; ab.n_states < 2 * the_node_size; ab.n_states *= 2);
+  ab.n_hashes = 2 * ab.n_states;
+  ab.states = tl_emalloc(ab.n_states * sizeof(*ab.states));
+  ab.hashes = tl_emalloc(ab.n_hashes * sizeof(*ab.hashes));
+  ab.sym_map = NULL;
+  if(max_sym_id >= 0) ab.sym_map = tl_emalloc((max_sym_id + 1) * sizeof(int));
+  for(i = 0; i <= max_sym_id; i++)
+    ab.sym_map[i] = -1;
+
+  /* size the sets by the distinct states and predicates */
+  number_boolean(p, &ab, &n_states, &n_syms);
+
+  alt.transition = (ATrans **) tl_emalloc((n_states + 1) * sizeof(ATrans *));
+  alt.sz.node_size = LTL2BA_SET_SIZE(n_states + 1);
+  if(n_syms) alt.sym_table = tl_emalloc(n_syms * sizeof(char *));
+  alt.sz.sym_size = LTL2BA_SET_SIZE(n_syms);
+  alt.final_set = make_set(-1, alt.sz.node_size);
 
-  int the_sym_size = calculate_sym_size(p); /* number of predicates */
-  if(the_sym_size) alt.sym_table = tl_emalloc(the_sym_size * sizeof(char *));
-  alt.sz.sym_size = LTL2BA_SET_SIZE(the_sym_size);
+  if(flags & LTL2BA_LAZY) { /* keeps the numbering */
+    alt.node_id = n_states + 1;
+    alt.sym_id = n_syms;
+    for(i = 1; i <= n_states; i++) {
+      const Node *q = ab.label[i];
+      if(q->ntyp == NOT) q = q->lft;
+      if(q->ntyp == PREDICATE)
+        alt.sym_table[ab.sym_map[q->sym->id]] = q->sym->name;
+      else if(q->ntyp == U_OPER)
+        add_set(alt.final_set, i);
+    }
+    ab.trans = (ATrans **) tl_emalloc((n_states + 1) * sizeof(ATrans *));
+    ab.built = make_set(-1, alt.sz.node_size);
+  } else {
+    memset(ab.states, 0, ab.n_states * sizeof(*ab.states));
+    for(i = 0; i <= max_sym_id; i++)
+      ab.sym_map[i] = -1;
+    ab.trans = alt.transition;
+    ab.built = NULL;
+  }
 
-  alt.final_set = make_set(-1, alt.sz.node_size);
-  alt.transition[0] = boolean(p, label, &alt); /* generates the alternating automaton */
+  alt.transition[0] = boolean(p, &ab, &alt); /* generates the alternating automaton */
+
+  if(flags & LTL2BA_LAZY) {
+    alt.lazy = tl_emalloc(sizeof(*alt.lazy));
+    alt.lazy->ab = ab;
+    alt.lazy->ready = make_set(-1, alt.sz.node_size);
+    alt.lazy->flags = flags;
+  } else {
+    if(ab.sym_map) tfree(ab.sym_map);
+    tfree(ab.states);
+    tfree(ab.hashes);
+  }
 
   if(flags & LTL2BA_VERBOSE) {
     fprintf(tl_out, "\nAlternating automaton before simplification\n");
-    print_alternating(tl_out, label, cexpr, &alt);
+    print_alternating(tl_out, ab.label, cexpr, &alt);
   }
 
-  if(flags & LTL2BA_SIMP_DIFF) {
-    simplify_astates(label, &alt, &cnts); /* keeps only accessible states */
+  if((flags & LTL2BA_SIMP_DIFF) && !alt.lazy) {
+    simplify_astates(ab.label, &alt, &cnts); /* keeps only accessible states */
     if(flags & LTL2BA_VERBOSE) {
       fprintf(tl_out, "\nAlternating automaton after simplification\n");
-      print_alternating(tl_out, label, cexpr, &alt);
+      print_alternating(tl_out, ab.label, cexpr, &alt);
     }
   }
 
@@ -430,10 +756,45 @@ Alternating mk_alternating(const Node *p, FILE *tl_out, const Cexprtab *cexpr,
     timeval_subtract (&t_diff, &tr_fin.ru_utime, &tr_debut.ru_utime);
     fprintf(tl_out, "\nBuilding and simplification of the alternating automaton: %ld.%06lis",
 		t_diff.tv_sec, t_diff.tv_usec);
-    fprintf(tl_out, "\n%i states, %i transitions\n", cnts.astate_count, cnts.atrans_count);
+    if(alt.lazy)
+      fprintf(tl_out, "\n%i states, transitions built on demand\n", n_states);
+    else
+      fprintf(tl_out, "\n%i states, %i transitions\n", cnts.astate_count, cnts.atrans_count);
   }
 
-  tfree(label);
+  /* lay the transitions of each state out contiguously for the product of
+   * mk_generalized(); lazy states get theirs when built */
+  for(i = 0; i < (alt.lazy ? 1 : alt.node_id); i++) {
+    ATrans *t = alt.transition[i];
+    alt.transition[i] = flat_trans(&alt.sz, t);
+    free_atrans(t, 1);
+  }
+
+  if(!alt.lazy) tfree(ab.label);
 
   return alt;
 }
+
+/* frees the alternating automaton, but for its sym_table */
+void free_alternating(Alternating *alt)
+{
+  struct ltl2ba_lazy *lz = alt->lazy;
+  int i;
+  for(i = 0; i < alt->node_id; i++)
+    if(alt->transition[i] && (!lz || !i || in_set(lz->ready, i)))
+      tfree(alt->transition[i]);
+  if(lz) {
+    if(lz->ab.sym_map) tfree(lz->ab.sym_map);
+    tfree(lz->ab.states);
+    tfree(lz->ab.hashes);
+    tfree(lz->ab.label);
+    tfree(lz->ab.trans);
+    tfree(lz->ab.built);
+    tfree(lz->ready);
+    tfree(lz);
+    alt->lazy = NULL;
+  }
+  free_all_atrans();
+  tfree(alt->transition);
+  tfree(alt->final_set);
+}
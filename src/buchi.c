@@ -8,6 +8,8 @@
 
 #include "internal.h"
 
+#include <pthread.h>
+
 #undef min
 #define min(x,y)        ((x<y)?x:y)
 
@@ -15,22 +17,45 @@
 |*              Structures and shared variables                     *|
 \********************************************************************/
 
-typedef struct BScc {
-  BState *bstate;
-  int rank;
-  int theta;
-  struct BScc *nxt;
-} BScc;
-
+/* the depth-first search of bdfs(), by the rank of the states in it: while a
+ * state is on the stack, its 'incoming' field holds its rank */
 struct bdfs_state {
   int rank;
-  BScc *scc_stack;
+  BState **state;   /* the state of each rank */
+  BTrans **next;    /* its next transition to follow */
+  int *theta;       /* the lowest rank it reaches on the stack */
+  int *stack, size; /* the ranks in the current sccs */
+  int *on_stack;    /* set of these ranks */
+  int *path, depth; /* the ranks from the root to the current state */
 };
 
 struct bcounts {
   int bstate_count, btrans_count;
 };
 
+/* the states being built, in any of the lists find_bstate() used to search,
+ * by their generalized state and final value */
+struct bindex {
+  BState **tab;     /* NULL if the slot is free */
+  int size, used;   /* size is a power of 2 */
+};
+
+/* the transitions kept so far from a state to the state of (to, final)
+ * (expand_bstate()) */
+struct btarget {
+  GState *to;       /* NULL if the slot is free */
+  int final;
+  int head;         /* the last one kept, -1 if none is left */
+};
+
+/* the transitions of the states of a generalized state and a final value, in
+ * the order of the transitions of the generalized state */
+struct bexpand {
+  int n;            /* the number of transitions of the generalized state */
+  int *final;       /* the final value of the target of each of them */
+  int *kept;        /* whether each of them makes a transition */
+};
+
 /* Record of what states stutter-accept, according to each input symbol. */
 struct accept_sets {
   int **stutter_accept_table;
@@ -69,52 +94,88 @@ static BState *remove_bstate(BState *s, BState *s1, BState *const bremoved)
   s->trans = (BTrans *)0;
   s->nxt = bremoved->nxt;
   bremoved->nxt = s;
-  s->prv = s1;
-  for(s1 = bremoved->nxt; s1 != bremoved; s1 = s1->nxt)
-    if(s1->prv == s)
-      s1->prv = s->prv;
+  s->prv = s1; /* followed by forward_bstate() */
   return prv;
 }
 
+/* returns the state which replaces a removed state, NULL if none does: the
+ * removed states form a forest by their 'prv' field, whose paths are shortened
+ * on the way */
+static BState *forward_bstate(BState *s)
+{
+  BState *r, *nxt;
+  for(r = s; r && !r->trans; r = r->prv);
+  for(; s != r; s = nxt) {
+    nxt = s->prv;
+    s->prv = r;
+  }
+  return r;
+}
+
 static void copy_btrans(const set_sizes *sz, BTrans *from, BTrans *to) {
   to->to    = from->to;
   copy_set(from->pos, to->pos, sz->sym_size);
   copy_set(from->neg, to->neg, sz->sym_size);
 }
 
-/* simplifies the transitions */
+/* simplifies the transitions: only transitions with the same target can make
+ * one another redundant, so each group of them is compared on its own */
 static int simplify_btrans(Buchi *b, FILE *f, Flags flags)
 {
   BState *s;
-  BTrans *t, *t1;
-  int changed = 0;
+  BTrans *t, *t1, **v = NULL;
+  struct trans_ref *r = NULL;
+  int changed = 0, n, max = 0, i, j, k, l;
   struct rusage tr_debut, tr_fin;
   struct timeval t_diff;
 
   if(flags & LTL2BA_STATS) getrusage(RUSAGE_SELF, &tr_debut);
 
-  for (s = b->bstates->nxt; s != b->bstates; s = s->nxt)
-    for (t = s->trans->nxt; t != s->trans;) {
-      t1 = s->trans->nxt;
-      copy_btrans(&b->sz, t, s->trans);
-      while((t == t1) || (t->to != t1->to) ||
-            !included_set(t1->pos, t->pos, b->sz.sym_size) ||
-            !included_set(t1->neg, t->neg, b->sz.sym_size))
-        t1 = t1->nxt;
-      if(t1 != s->trans) {
-        BTrans *free = t->nxt;
-        t->to    = free->to;
-        copy_set(free->pos, t->pos, b->sz.sym_size);
-        copy_set(free->neg, t->neg, b->sz.sym_size);
-        t->nxt   = free->nxt;
-        if(free == s->trans) s->trans = t;
-        free_btrans(free, 0, 0);
-        changed++;
+  for (s = b->bstates->nxt; s != b->bstates; s = s->nxt) {
+    for(n = 0, t = s->trans->nxt; t != s->trans; t = t->nxt)
+      n++;
+    if(!n) continue;
+    if(n > max) {
+      if(v) { tfree(v); tfree(r); }
+      max = 2 * n;
+      v = (BTrans **)tl_emalloc(max * sizeof(*v));
+      r = (struct trans_ref *)tl_emalloc(max * sizeof(*r));
+    }
+    for(n = 0, t = s->trans->nxt; t != s->trans; t = t->nxt, n++) {
+      v[n] = t;
+      r[n].to = (uintptr_t)t->to;
+      r[n].i = n;
+    }
+    qsort(r, n, sizeof(*r), cmp_trans_ref);
+
+    for(i = 0; i < n; i = j) { /* the transitions to the same state as v[r[i].i] */
+      for(j = i + 1; j < n && r[j].to == r[i].to; j++);
+      for(k = i; k < j; k++) { /* tries to remove t */
+        t = v[r[k].i];
+        for(l = i; l < j; l++) {
+          t1 = v[r[l].i];
+          if((l != k) && t1 &&
+             included_set(t1->pos, t->pos, b->sz.sym_size) &&
+             included_set(t1->neg, t->neg, b->sz.sym_size))
+            break;
+        }
+        if(l < j) {
+          v[r[k].i] = NULL;
+          free_btrans(t, 0, 0);
+          changed++;
+        }
       }
-      else
-        t = t->nxt;
     }
 
+    for(t = s->trans, k = 0; k < n; k++) /* links the remaining ones in order */
+      if(v[k]) {
+        t->nxt = v[k];
+        t = v[k];
+      }
+    t->nxt = s->trans;
+  }
+  if(v) { tfree(v); tfree(r); }
+
   if(flags & LTL2BA_STATS) {
     getrusage(RUSAGE_SELF, &tr_fin);
     timeval_subtract (&t_diff, &tr_fin.ru_utime, &tr_debut.ru_utime);
@@ -160,7 +221,7 @@ static void retarget_all_btrans(Buchi *b, BState *const bremoved)
   for (s = b->bstates->nxt; s != b->bstates; s = s->nxt)
     for (t = s->trans->nxt; t != s->trans; t = t->nxt)
       if (!t->to->trans) { /* t->to has been removed */
-	t->to = t->to->prv;
+	t->to = forward_bstate(t->to);
 	if(!t->to) { /* t->to has no transitions */
 	  BTrans *free = t->nxt;
 	  t->to = free->to;
@@ -214,11 +275,32 @@ static int all_btrans_match(Buchi *buchi, BState *a, BState *b)
   return 1;
 }
 
+/*
+ * As merging equivalent states can change the 'final' attribute of
+ * the remaining state, it is possible that now there are two
+ * different states with the same id and final values.
+ * This would lead to multiply-defined labels in the generated neverclaim.
+ * We iterate over all states and assign new ids (previously unassigned)
+ * to these states to disambiguate.
+ * Fix from ltl3ba.
+ */
+static void disambiguate_bstates(Buchi *b, int *gstate_id)
+{
+  BState *s, *s2;
+  for (s = b->bstates->nxt; s != b->bstates; s = s->nxt) { /* For all states s*/
+    for (s2 = s->nxt; s2 != b->bstates; s2 = s2->nxt) {    /* and states s2 to the right of s */
+      if(s->final == s2->final && s->id == s2->id) {       /* if final and id match */
+        s->id = ++*gstate_id;                              /* disambiguate by assigning unused id */
+      }
+    }
+  }
+}
+
 /* eliminates redundant states */
 static int simplify_bstates(Buchi *b, FILE *f, Flags flags, int *gstate_id,
                             BState *const bremoved)
 {
-  BState *s, *s1, *s2;
+  BState *s, *s1;
   int changed = 0;
   struct rusage tr_debut, tr_fin;
   struct timeval t_diff;
@@ -270,23 +352,7 @@ static int simplify_bstates(Buchi *b, FILE *f, Flags flags, int *gstate_id,
     }
   }
   retarget_all_btrans(b, bremoved);
-
-  /*
-   * As merging equivalent states can change the 'final' attribute of
-   * the remaining state, it is possible that now there are two
-   * different states with the same id and final values.
-   * This would lead to multiply-defined labels in the generated neverclaim.
-   * We iterate over all states and assign new ids (previously unassigned)
-   * to these states to disambiguate.
-   * Fix from ltl3ba.
-   */
-  for (s = b->bstates->nxt; s != b->bstates; s = s->nxt) { /* For all states s*/
-    for (s2 = s->nxt; s2 != b->bstates; s2 = s2->nxt) {    /* and states s2 to the right of s */
-      if(s->final == s2->final && s->id == s2->id) {       /* if final and id match */
-        s->id = ++*gstate_id;                              /* disambiguate by assigning unused id */
-      }
-    }
-  }
+  disambiguate_bstates(b, gstate_id);
 
   if(flags & LTL2BA_STATS) {
     getrusage(RUSAGE_SELF, &tr_fin);
@@ -299,95 +365,610 @@ static int simplify_bstates(Buchi *b, FILE *f, Flags flags, int *gstate_id,
   return changed;
 }
 
-static int bdfs(BState *s, struct bdfs_state *st) {
-  BTrans *t;
-  BScc *c;
-  BScc *scc = (BScc *)tl_emalloc(sizeof(BScc));
-  scc->bstate = s;
-  scc->rank = st->rank;
-  scc->theta = st->rank++;
-  scc->nxt = st->scc_stack;
-  st->scc_stack = scc;
+/* a transition in bisim_bstates(): its label, numbered among the distinct
+ * (pos, neg) pairs, and the block of its target */
+struct bpair {
+  int label, block;
+};
 
-  s->incoming = 1;
+static int cmp_bpair(const void *a, const void *b)
+{
+  const struct bpair *x = a, *y = b;
+  if (x->label != y->label)
+    return x->label < y->label ? -1 : 1;
+  return x->block - y->block;
+}
+
+/* the data of bisim_bstates() and sim_bstates(), for states numbered in the
+ * order of the list */
+struct bisim {
+  int n, m, labels;     /* the numbers of states, transitions and labels */
+  BState **state;
+  int *off;             /* the transitions of state i: off[i] to off[i+1] */
+  BTrans **trans;
+  int *label, *to;      /* of each transition */
+  struct bpair *pairs;  /* the distinct (label, block) of state i from off[i] */
+  int *len;             /* their number */
+  int *block, *next;    /* the blocks of the current and of the next round */
+  int *tab, mask;       /* hash table of states + 1, 0 if the slot is free */
+};
 
-  for (t = s->trans->nxt; t != s->trans; t = t->nxt) {
-    if (t->to->incoming == 0) {
-      int result = bdfs(t->to, st);
-      scc->theta = min(scc->theta, result);
+/* numbers the label of transition j, the labels of the transitions before it
+ * being numbered in 'tab' */
+static void bisim_label(const Buchi *b, struct bisim *x, int *tab,
+                        unsigned mask, int j, int *labels)
+{
+  BTrans *t = x->trans[j], *t1;
+  unsigned i = (hash_set(t->pos, b->sz.sym_size) * 31u) ^
+               hash_set(t->neg, b->sz.sym_size);
+  for(i &= mask; tab[i]; i = (i + 1) & mask) {
+    t1 = x->trans[tab[i] - 1];
+    if(same_sets(t->pos, t1->pos, b->sz.sym_size) &&
+       same_sets(t->neg, t1->neg, b->sz.sym_size)) {
+      x->label[j] = x->label[tab[i] - 1];
+      return;
     }
-    else {
-      for(c = st->scc_stack->nxt; c != 0; c = c->nxt)
-	if(c->bstate == t->to) {
-	  scc->theta = min(scc->theta, c->rank);
-	  break;
-	}
+  }
+  tab[i] = j + 1;
+  x->label[j] = (*labels)++;
+}
+
+/* numbers the states, their transitions and the labels of these */
+static int number_bstates(const Buchi *b, struct bisim *x)
+{
+  BState *s;
+  BTrans *t;
+  int *ltab, lsize = 1, i, j;
+
+  x->n = x->m = x->labels = 0;
+  for(s = b->bstates->nxt; s != b->bstates; s = s->nxt) {
+    x->n++;
+    for(t = s->trans->nxt; t != s->trans; t = t->nxt)
+      x->m++;
+  }
+  if(!x->n) return 0;
+  while(lsize < 2 * x->m)
+    lsize *= 2;
+  x->state = (BState **)tl_emalloc(x->n * sizeof(*x->state));
+  x->off = (int *)tl_emalloc((x->n + 1) * sizeof(*x->off));
+  x->trans = (BTrans **)tl_emalloc((x->m + 1) * sizeof(*x->trans));
+  x->label = (int *)tl_emalloc((x->m + 1) * sizeof(*x->label));
+  x->to = (int *)tl_emalloc((x->m + 1) * sizeof(*x->to));
+  x->next = (int *)tl_emalloc(x->n * sizeof(*x->next));
+  ltab = (int *)tl_emalloc(lsize * sizeof(*ltab));
+
+  /* numbers the states in their 'incoming' field for a while */
+  for(i = 0, s = b->bstates->nxt; s != b->bstates; s = s->nxt, i++) {
+    x->state[i] = s;
+    x->next[i] = s->incoming;
+    s->incoming = i;
+  }
+  for(i = j = 0; i < x->n; i++) {
+    x->off[i] = j;
+    for(t = x->state[i]->trans->nxt; t != x->state[i]->trans; t = t->nxt, j++) {
+      x->trans[j] = t;
+      x->to[j] = t->to->incoming;
+      bisim_label(b, x, ltab, lsize - 1, j, &x->labels);
     }
   }
-  if(scc->rank == scc->theta) {
-    if(st->scc_stack == scc) { /* s is alone in a scc */
-      s->incoming = -1;
-      for (t = s->trans->nxt; t != s->trans; t = t->nxt)
-	if (t->to == s)
-	  s->incoming = 1;
+  x->off[x->n] = j;
+  for(i = 0; i < x->n; i++)
+    x->state[i]->incoming = x->next[i];
+  tfree(ltab);
+  return x->n;
+}
+
+static void free_numbering(struct bisim *x)
+{
+  tfree(x->state);
+  tfree(x->off);
+  tfree(x->trans);
+  tfree(x->label);
+  tfree(x->to);
+  tfree(x->next);
+}
+
+/* computes the (label, block) pairs of state i */
+static void bisim_pairs(struct bisim *x, int i)
+{
+  struct bpair *p = x->pairs + x->off[i];
+  int j, k, n = x->off[i + 1] - x->off[i];
+  for(j = 0; j < n; j++) {
+    p[j].label = x->label[x->off[i] + j];
+    p[j].block = x->block[x->to[x->off[i] + j]];
+  }
+  if(n) qsort(p, n, sizeof(*p), cmp_bpair);
+  for(j = k = 0; j < n; j++)
+    if(!k || cmp_bpair(&p[k - 1], &p[j]))
+      p[k++] = p[j];
+  x->len[i] = k;
+}
+
+static unsigned bisim_hash(const struct bisim *x, int i)
+{
+  const struct bpair *p = x->pairs + x->off[i];
+  unsigned h = 0;
+  int j;
+  for(j = 0; j < x->len[i]; j++)
+    h = ((h ^ (unsigned)p[j].label) * 0x01000193u) ^
+        ((unsigned)p[j].block * 0x9e3779b1u);
+  return h;
+}
+
+static int bisim_same_pairs(const struct bisim *x, int i, int j)
+{
+  return x->len[i] == x->len[j] &&
+         !memcmp(x->pairs + x->off[i], x->pairs + x->off[j],
+                 x->len[i] * sizeof(*x->pairs));
+}
+
+/* returns the first state of the table with the same pairs as state i (and
+ * the same block if 'block'), or -1 and the free slot in *h */
+static int bisim_find(const struct bisim *x, int i, int block, unsigned *h)
+{
+  unsigned k = bisim_hash(x, i);
+  int j;
+  if(block) k ^= (unsigned)x->block[i] * 0x85ebca6bu;
+  for(k &= x->mask; (j = x->tab[k]); k = (k + 1) & x->mask)
+    if((!block || x->block[j - 1] == x->block[i]) &&
+       bisim_same_pairs(x, i, j - 1))
+      return j - 1;
+  *h = k;
+  return -1;
+}
+
+/* merges the bisimilar states: two states stay in the same block as long as
+ * they have the same labels to the same blocks. The first blocks separate the
+ * accepting states from the others, and the states in a trivial scc
+ * (incoming == -1) from both: the acceptance of these can be changed, so their
+ * blocks are then merged with any block of the same transitions */
+static int bisim_bstates(Buchi *b, FILE *f, Flags flags, int *gstate_id,
+                         BState *const bremoved)
+{
+  struct bisim x;
+  BState *s;
+  int *trivial, *first, *last, *merged;
+  int n, size = 1, blocks, changed = 0;
+  int i, j, k;
+  unsigned h;
+  struct rusage tr_debut, tr_fin;
+  struct timeval t_diff;
+
+  if(flags & LTL2BA_STATS) getrusage(RUSAGE_SELF, &tr_debut);
+
+  if(!(n = number_bstates(b, &x))) return 0;
+  while(size < 2 * n)
+    size *= 2;
+  x.pairs = (struct bpair *)tl_emalloc((x.m + 1) * sizeof(*x.pairs));
+  x.len = (int *)tl_emalloc(n * sizeof(*x.len));
+  x.block = (int *)tl_emalloc(n * sizeof(*x.block));
+  x.tab = (int *)tl_emalloc(size * sizeof(*x.tab));
+  x.mask = size - 1;
+  trivial = (int *)tl_emalloc(n * sizeof(*trivial));
+  for(i = 0; i < n; i++) {
+    trivial[i] = (x.state[i]->incoming == -1);
+    x.block[i] = trivial[i] ? 0 : (x.state[i]->final == b->accept) ? 1 : 2;
+  }
+
+  /* refines the blocks until none is split: the numbers of the blocks then
+   * stay the same, those of the first state of each in order */
+  for(blocks = -1;;) {
+    memset(x.tab, 0, size * sizeof(*x.tab));
+    for(i = k = 0; i < n; i++) {
+      bisim_pairs(&x, i);
+      if((j = bisim_find(&x, i, 1, &h)) >= 0)
+        x.next[i] = x.next[j];
+      else {
+        x.tab[h] = i + 1;
+        x.next[i] = k++;
+      }
     }
-    st->scc_stack = scc->nxt;
+    if(k == blocks) /* the pairs refer to the final blocks */
+      break;
+    blocks = k;
+    memcpy(x.block, x.next, n * sizeof(*x.block));
+  }
+
+  /* merges each block of trivial states with the first block of other states
+   * with the same pairs, if any */
+  first = (int *)tl_emalloc(blocks * sizeof(*first));
+  last = (int *)tl_emalloc(blocks * sizeof(*last));
+  merged = (int *)tl_emalloc(blocks * sizeof(*merged));
+  for(i = 0, k = 0; i < n; i++)
+    if(x.block[i] == k) /* the first state of block k */
+      first[k++] = i;
+  memset(x.tab, 0, size * sizeof(*x.tab));
+  for(k = 0; k < blocks; k++) {
+    merged[k] = k;
+    if(!trivial[i = first[k]] && bisim_find(&x, i, 0, &h) < 0)
+      x.tab[h] = i + 1;
   }
-  return scc->theta;
+  for(k = 0; k < blocks; k++)
+    if(trivial[i = first[k]] && (j = bisim_find(&x, i, 0, &h)) >= 0)
+      merged[k] = x.block[j];
+  for(i = 0; i < n; i++) {
+    x.block[i] = merged[x.block[i]];
+    last[x.block[i]] = i; /* the state that stays: the initial one is last */
+  }
+
+  for(i = 0; i < n; i++) {
+    s = x.state[last[x.block[i]]];
+    if(s->incoming == -1 && !trivial[i]) { /* s takes the acceptance of i */
+      s->final = x.state[i]->final;
+      s->incoming = 1;
+    }
+  }
+  for(i = 0; i < n; i++) {
+    s = x.state[i];
+    if(s->trans == s->trans->nxt) /* s has no transitions */
+      remove_bstate(s, (BState *)0, bremoved);
+    else if(s != x.state[last[x.block[i]]])
+      remove_bstate(s, x.state[last[x.block[i]]], bremoved);
+    else
+      continue;
+    changed++;
+  }
+  retarget_all_btrans(b, bremoved);
+  disambiguate_bstates(b, gstate_id);
+
+  tfree(first);
+  tfree(last);
+  tfree(merged);
+  tfree(trivial);
+  tfree(x.pairs);
+  tfree(x.len);
+  tfree(x.block);
+  tfree(x.tab);
+  free_numbering(&x);
+
+  if(flags & LTL2BA_STATS) {
+    getrusage(RUSAGE_SELF, &tr_fin);
+    timeval_subtract (&t_diff, &tr_fin.ru_utime, &tr_debut.ru_utime);
+    fprintf(f, "\nSimplification of the Buchi automaton - bisimulation: %ld.%06lis",
+		t_diff.tv_sec, t_diff.tv_usec);
+    fprintf(f, "\n%i states removed\n", changed);
+  }
+
+  return changed;
+}
+
+static void bdfs_push(BState *s, struct bdfs_state *st)
+{
+  int r = st->rank++;
+  st->state[r] = s;
+  st->next[r] = s->trans->nxt;
+  st->theta[r] = r;
+  st->stack[st->size++] = r;
+  add_set(st->on_stack, r);
+  st->path[st->depth++] = r;
+  s->incoming = r;
 }
 
+/* marks the states reachable from s: -1 if alone in a scc without a loop, 1
+ * otherwise */
+static void bdfs(BState *s, struct bdfs_state *st)
+{
+  BTrans *t;
+  int r, x;
+
+  bdfs_push(s, st);
+  while(st->depth) {
+    r = st->path[st->depth - 1];
+    s = st->state[r];
+    if((t = st->next[r]) != s->trans) {
+      st->next[r] = t->nxt;
+      x = t->to->incoming;
+      if(x == 0)
+        bdfs_push(t->to, st);
+      else if(x > 0 && x < st->rank && in_set(st->on_stack, x) &&
+              st->state[x] == t->to)
+        st->theta[r] = min(st->theta[r], x);
+      continue;
+    }
+    st->depth--; /* all the transitions of s are followed */
+    if(st->theta[r] == r) {
+      if(st->stack[st->size - 1] == r) { /* s is alone in a scc */
+        s->incoming = -1;
+        for (t = s->trans->nxt; t != s->trans; t = t->nxt)
+          if (t->to == s)
+            s->incoming = 1;
+      }
+      else
+        s->incoming = 1;
+      do {
+        x = st->stack[--st->size];
+        rem_set(st->on_stack, x);
+        if(x != r) st->state[x]->incoming = 1;
+      } while(x != r);
+    }
+    if(st->depth) {
+      x = st->path[st->depth - 1];
+      st->theta[x] = min(st->theta[x], st->theta[r]);
+    }
+  }
+}
 
 static void simplify_bscc(Buchi *b, BState *const bremoved) {
   BState *s;
+  int n = 0;
   struct bdfs_state st;
   st.rank = 1;
-  st.scc_stack = NULL;
+  st.size = 0;
+  st.depth = 0;
 
   if(b->bstates == b->bstates->nxt) return;
 
-  for(s = b->bstates->nxt; s != b->bstates; s = s->nxt)
+  for(s = b->bstates->nxt; s != b->bstates; s = s->nxt) {
     s->incoming = 0; /* state color = white */
+    n++;
+  }
+  st.state = (BState **)tl_emalloc((n + 1) * sizeof(*st.state));
+  st.next = (BTrans **)tl_emalloc((n + 1) * sizeof(*st.next));
+  st.theta = (int *)tl_emalloc((n + 1) * sizeof(*st.theta));
+  st.stack = (int *)tl_emalloc((n + 1) * sizeof(*st.stack));
+  st.path = (int *)tl_emalloc((n + 1) * sizeof(*st.path));
+  st.on_stack = make_set(-1, LTL2BA_SET_SIZE(n + 1));
 
   bdfs(b->bstates->prv, &st);
 
+  tfree(st.state);
+  tfree(st.next);
+  tfree(st.theta);
+  tfree(st.stack);
+  tfree(st.path);
+  tfree(st.on_stack);
+
   for(s = b->bstates->nxt; s != b->bstates; s = s->nxt)
     if(s->incoming == 0)
-      remove_bstate(s, 0, bremoved);
+      s = remove_bstate(s, 0, bremoved);
 }
 
 
 
 
+/* reduces the automaton by direct simulation: state j simulates state i if j
+ * is accepting when i is, and each transition of i is matched by one of j with
+ * a more general label to a state simulating its target. A transition is
+ * removed if another one of its state with a more general label goes to a
+ * state strictly simulating its target, then the states simulating each other
+ * are merged */
+static int sim_bstates(Buchi *b, FILE *f, Flags flags, BState *const bremoved)
+{
+  struct bisim x;
+  BState *s;
+  BTrans *t, **rep_t;
+  int **sim, **incl, *keep;
+  int **shrunk, *poff, *pred, *queue, *queued, head, len;
+  int n, i, j, k, k1, l, changed, merged = 0, pruned = 0;
+  struct rusage tr_debut, tr_fin;
+  struct timeval t_diff;
+
+  if(flags & LTL2BA_STATS) getrusage(RUSAGE_SELF, &tr_debut);
+
+  if(!(n = number_bstates(b, &x))) return 0;
+
+  /* incl[l] is the set of the labels more general than l */
+  rep_t = (BTrans **)tl_emalloc((x.labels + 1) * sizeof(*rep_t));
+  for(k = x.m; k-- > 0;)
+    rep_t[x.label[k]] = x.trans[k];
+  incl = (int **)tl_emalloc((x.labels + 1) * sizeof(*incl));
+  for(l = 0; l < x.labels; l++) {
+    incl[l] = make_set(-1, LTL2BA_SET_SIZE(x.labels));
+    for(k = 0; k < x.labels; k++)
+      if(included_set(rep_t[k]->pos, rep_t[l]->pos, b->sz.sym_size) &&
+         included_set(rep_t[k]->neg, rep_t[l]->neg, b->sz.sym_size))
+        add_set(incl[l], k);
+  }
+
+  /* the predecessors of state i: pred[poff[i]] to pred[poff[i + 1]] */
+  poff = (int *)tl_emalloc((n + 1) * sizeof(*poff));
+  pred = (int *)tl_emalloc((x.m + 1) * sizeof(*pred));
+  for(k = 0; k < x.m; k++)
+    poff[x.to[k]]++;
+  for(i = 1; i <= n; i++)
+    poff[i] += poff[i - 1];
+  for(i = n; i-- > 0;)
+    for(k = x.off[i + 1]; k-- > x.off[i];)
+      pred[--poff[x.to[k]]] = i;
+
+  /* sim[i] is the set of the states simulating i, refined until it is a
+   * simulation: the row of a state is checked again only when the row of one
+   * of its successors has shrunk, which shrunk[i] records, and then only for
+   * its transitions to these successors */
+  sim = (int **)tl_emalloc(n * sizeof(*sim));
+  for(i = 0; i < n; i++) {
+    sim[i] = make_set(-1, LTL2BA_SET_SIZE(n));
+    for(j = 0; j < n; j++)
+      if(x.state[i]->final != b->accept || x.state[j]->final == b->accept)
+        add_set(sim[i], j);
+  }
+  shrunk = (int **)tl_emalloc(n * sizeof(*shrunk));
+  queue = (int *)tl_emalloc(n * sizeof(*queue));
+  queued = (int *)tl_emalloc(n * sizeof(*queued));
+  for(i = 0; i < n; i++) {
+    shrunk[i] = make_set(-1, LTL2BA_SET_SIZE(n));
+    queue[i] = i;
+    queued[i] = 2; /* all of its transitions are checked */
+  }
+  for(head = 0, len = n; len;) {
+    i = queue[head];
+    head = (head + 1) % n;
+    len--;
+    changed = 0;
+    for(j = 0; j < n; j++) {
+      if(j == i || !in_set(sim[i], j)) continue;
+      for(k = x.off[i]; k < x.off[i + 1]; k++) {
+        if(queued[i] == 1 && !in_set(shrunk[i], x.to[k]))
+          continue;
+        for(k1 = x.off[j]; k1 < x.off[j + 1]; k1++)
+          if(in_set(incl[x.label[k]], x.label[k1]) &&
+             in_set(sim[x.to[k]], x.to[k1]))
+            break;
+        if(k1 == x.off[j + 1]) /* transition k is not matched */
+          break;
+      }
+      if(k < x.off[i + 1]) {
+        rem_set(sim[i], j);
+        changed = 1;
+      }
+    }
+    queued[i] = 0;
+    clear_set(shrunk[i], LTL2BA_SET_SIZE(n));
+    if(changed)
+      for(k = poff[i]; k < poff[i + 1]; k++) {
+        add_set(shrunk[pred[k]], i);
+        if(!queued[pred[k]]) {
+          queued[pred[k]] = 1;
+          queue[(head + len) % n] = pred[k];
+          len++;
+        }
+      }
+  }
+
+  /* removes the transitions to little brothers, then relinks the others */
+  keep = (int *)tl_emalloc((x.m + 1) * sizeof(*keep));
+  for(i = 0; i < n; i++) {
+    for(k = x.off[i]; k < x.off[i + 1]; k++) {
+      keep[k] = 1;
+      for(k1 = x.off[i]; k1 < x.off[i + 1]; k1++)
+        if(in_set(incl[x.label[k]], x.label[k1]) &&
+           in_set(sim[x.to[k]], x.to[k1]) && !in_set(sim[x.to[k1]], x.to[k])) {
+          keep[k] = 0;
+          break;
+        }
+    }
+    s = x.state[i];
+    for(t = s->trans, k = x.off[i]; k < x.off[i + 1]; k++)
+      if(keep[k]) {
+        t->nxt = x.trans[k];
+        t = x.trans[k];
+      }
+    t->nxt = s->trans;
+    for(k = x.off[i]; k < x.off[i + 1]; k++)
+      if(!keep[k]) {
+        free_btrans(x.trans[k], 0, 0);
+        pruned++;
+      }
+  }
+
+  /* replaces each state by the last one simulating each other with it: the
+   * initial one is last */
+  for(i = 0; i < n; i++)
+    for(j = n - 1; j > i; j--)
+      if(in_set(sim[i], j) && in_set(sim[j], i)) {
+        remove_bstate(x.state[i], x.state[j], bremoved);
+        merged++;
+        break;
+      }
+  retarget_all_btrans(b, bremoved);
+
+  for(i = 0; i < n; i++) {
+    tfree(sim[i]);
+    tfree(shrunk[i]);
+  }
+  for(l = 0; l < x.labels; l++)
+    tfree(incl[l]);
+  tfree(sim);
+  tfree(incl);
+  tfree(shrunk);
+  tfree(poff);
+  tfree(pred);
+  tfree(queue);
+  tfree(queued);
+  tfree(rep_t);
+  tfree(keep);
+  free_numbering(&x);
+
+  if(flags & LTL2BA_STATS) {
+    getrusage(RUSAGE_SELF, &tr_fin);
+    timeval_subtract (&t_diff, &tr_fin.ru_utime, &tr_debut.ru_utime);
+    fprintf(f, "\nSimplification of the Buchi automaton - simulation: %ld.%06lis",
+		t_diff.tv_sec, t_diff.tv_usec);
+    fprintf(f, "\n%i states removed, %i transitions removed\n", merged, pruned);
+  }
+
+  return merged + pruned;
+}
+
+/* eliminates redundant states, in the ways chosen by the flags; the scc marks
+ * stay up to date. The simulation is not computed again once it has found
+ * nothing, which *sim_done records */
+static int reduce_bstates(Buchi *b, FILE *f, Flags flags, int *gstate_id,
+                          BState *const bremoved, int *sim_done)
+{
+  int changed = (flags & LTL2BA_SIMP_BISIM)
+                ? bisim_bstates(b, f, flags, gstate_id, bremoved)
+                : simplify_bstates(b, f, flags, gstate_id, bremoved);
+  int reduced = 0;
+  if((flags & LTL2BA_SIMP_SIM) && !*sim_done)
+    *sim_done = !(reduced = sim_bstates(b, f, flags, bremoved));
+  /* the removed transitions may leave states unreachable, and the merged
+   * states may close loops */
+  if(reduced && (flags & LTL2BA_SIMP_SCC))
+    simplify_bscc(b, bremoved);
+  return changed + reduced;
+}
+
 /********************************************************************\
 |*              Generation of the Buchi automaton                   *|
 \********************************************************************/
 
+static unsigned bindex_hash(GState *gstate, int final)
+{
+  return ((unsigned)((uintptr_t)gstate >> 4) ^ (unsigned)final * 0x9e3779b1u)
+         * 0x01000193u;
+}
+
+/* returns the slot of the state of (gstate, final), or the free slot where
+ * it belongs */
+static BState **bindex_slot(const struct bindex *ix, GState *gstate,
+                            int final)
+{
+  unsigned mask = ix->size - 1, i = bindex_hash(gstate, final) & mask;
+  for(; ix->tab[i]; i = (i + 1) & mask)
+    if(ix->tab[i]->gstate == gstate && ix->tab[i]->final == final)
+      break;
+  return &ix->tab[i];
+}
+
+static void bindex_add(struct bindex *ix, BState *s)
+{
+  if(2 * ++ix->used > ix->size) { /* rehashes */
+    BState **old = ix->tab;
+    int i, n = ix->size;
+    ix->size *= 2;
+    ix->tab = tl_emalloc(ix->size * sizeof(*ix->tab));
+    for(i = 0; i < n; i++)
+      if(old[i]) *bindex_slot(ix, old[i]->gstate, old[i]->final) = old[i];
+    tfree(old);
+  }
+  *bindex_slot(ix, s->gstate, s->final) = s;
+}
+
+/* forgets s, before it is freed */
+static void bindex_del(struct bindex *ix, BState *s)
+{
+  unsigned mask = ix->size - 1, i, j, k;
+  i = bindex_slot(ix, s->gstate, s->final) - ix->tab;
+  for(j = i; ix->tab[j = (j + 1) & mask]; ) {
+    k = bindex_hash(ix->tab[j]->gstate, ix->tab[j]->final) & mask;
+    if((i < j) ? (k <= i || k > j) : (k <= i && k > j)) { /* probed past i */
+      ix->tab[i] = ix->tab[j];
+      i = j;
+    }
+  }
+  ix->tab[i] = NULL;
+  ix->used--;
+}
+
 /* finds the corresponding state, or creates it */
 static BState *find_bstate(Buchi *b, GState **state, int final, BState *s,
-                           BState *const bstack, BState *const bremoved)
+                           BState *const bstack, struct bindex *ix)
 {
   if((s->gstate == *state) && (s->final == final)) return s; /* same state */
 
-  s = bstack->nxt; /* in the stack */
-  bstack->gstate = *state;
-  bstack->final = final;
-  while(!(s->gstate == *state) || !(s->final == final))
-    s = s->nxt;
-  if(s != bstack) return s;
-
-  s = b->bstates->nxt; /* in the solved states */
-  b->bstates->gstate = *state;
-  b->bstates->final = final;
-  while(!(s->gstate == *state) || !(s->final == final))
-    s = s->nxt;
-  if(s != b->bstates) return s;
-
-  s = bremoved->nxt; /* in the removed states */
-  bremoved->gstate = *state;
-  bremoved->final = final;
-  while(!(s->gstate == *state) || !(s->final == final))
-    s = s->nxt;
-  if(s != bremoved) return s;
+  /* in the stack, in the solved states or in the removed states */
+  if((s = *bindex_slot(ix, *state, final))) return s;
 
   s = (BState *)tl_emalloc(sizeof(BState)); /* creates a new state */
   s->gstate = *state;
@@ -398,62 +979,114 @@ static BState *find_bstate(Buchi *b, GState **state, int final, BState *s,
   s->trans->nxt = s->trans;
   s->nxt = bstack->nxt;
   bstack->nxt = s;
+  bindex_add(ix, s);
   return s;
 }
 
-static int next_final(Buchi *b, int *set, int fin, const int *final) /* computes the 'final' value */
+static int next_final(const Buchi *b, int *set, int fin, const int *final) /* computes the 'final' value */
 {
   if((fin != b->accept) && in_set(set, final[fin + 1]))
     return next_final(b, set, fin + 1, final);
   return fin;
 }
 
-/* creates all the transitions from a state */
-static void make_btrans(Buchi *b, BState *s, const int *final, Flags flags,
-                        struct bcounts *c, BState *const bstack,
-                        BState *const bremoved)
+/* returns the slot of the state of (to, final) in a table of 'mask' + 1
+ * slots */
+static struct btarget *btarget_slot(struct btarget *tab, unsigned mask,
+                                    GState *to, int final)
+{
+  unsigned i = bindex_hash(to, final);
+  for(i &= mask; tab[i].to && (tab[i].to != to || tab[i].final != final);
+      i = (i + 1) & mask);
+  return &tab[i];
+}
+
+/* computes the transitions of the states of (gstate, sfinal), without
+ * touching the automaton: several threads may expand states at once */
+static struct bexpand *expand_bstate(const Buchi *b, GState *gstate, int sfinal,
+                                     const int *final, Flags flags)
+{
+  int i, k, *pi, n = 0, size = 1;
+  int *same;
+  GTrans *t, **v;
+  struct btarget *tab;
+  struct bexpand *e;
+
+  if(gstate->trans)
+    for(t = gstate->trans->nxt; t != gstate->trans; t = t->nxt)
+      n++;
+  e = malloc(sizeof(*e) + 2 * n * sizeof(int));
+  if(!e) fatal("not enough memory");
+  e->n = n;
+  e->final = (int *)(e + 1);
+  e->kept = e->final + n;
+  if(!n) return e;
+
+  while(size < 2 * n)
+    size *= 2;
+  v = (GTrans **)tl_emalloc(n * sizeof(*v));
+  same = (int *)tl_emalloc(n * sizeof(*same));
+  tab = (struct btarget *)tl_emalloc(size * sizeof(*tab));
+  for(k = 0, t = gstate->trans->nxt; t != gstate->trans; t = t->nxt, k++) {
+    int fin = next_final(b, t->final, (sfinal == b->accept) ? 0 : sfinal, final);
+    struct btarget *bt = btarget_slot(tab, size - 1, t->to, fin);
+
+    v[k] = t;
+    e->final[k] = fin;
+    e->kept[k] = 1;
+    if(!(flags & LTL2BA_SIMP_FLY)) continue;
+    if(!bt->to) {
+      bt->to = t->to;
+      bt->final = fin;
+      bt->head = -1;
+    }
+    /* only the transitions to the same state can be compared */
+    for(pi = &bt->head; (i = *pi) >= 0;) {
+      if(included_set(t->pos, v[i]->pos, b->sz.sym_size) &&
+         included_set(t->neg, v[i]->neg, b->sz.sym_size)) { /* v[i] is redondant */
+        *pi = same[i];
+        e->kept[i] = 0;
+      }
+      else if(included_set(v[i]->pos, t->pos, b->sz.sym_size) &&
+              included_set(v[i]->neg, t->neg, b->sz.sym_size)) /* t is redondant */
+        break;
+      else
+        pi = &same[i];
+    }
+    if(i >= 0)
+      e->kept[k] = 0;
+    else {
+      same[k] = bt->head;
+      bt->head = k;
+    }
+  }
+  tfree(v);
+  tfree(same);
+  tfree(tab);
+  return e;
+}
+
+/* creates all the transitions from a state, as expanded in e */
+static void make_btrans(Buchi *b, BState *s, const struct bexpand *e,
+                        Flags flags, struct bcounts *c, BState *const bstack,
+                        BState *const bremoved, struct bindex *ix)
 {
-  int state_trans = 0;
+  int k, state_trans = 0;
   GTrans *t;
-  BTrans *t1;
   BState *s1;
   if(s->gstate->trans)
-    for(t = s->gstate->trans->nxt; t != s->gstate->trans; t = t->nxt) {
-      int fin = next_final(b, t->final, (s->final == b->accept) ? 0 : s->final, final);
-      BState *to = find_bstate(b, &t->to, fin, s, bstack, bremoved);
-
-      for(t1 = s->trans->nxt; t1 != s->trans;) {
-	if((flags & LTL2BA_SIMP_FLY) &&
-	   (to == t1->to) &&
-	   included_set(t->pos, t1->pos, b->sz.sym_size) &&
-	   included_set(t->neg, t1->neg, b->sz.sym_size)) { /* t1 is redondant */
-	  BTrans *free = t1->nxt;
-	  t1->to->incoming--;
-	  t1->to = free->to;
-	  copy_set(free->pos, t1->pos, b->sz.sym_size);
-	  copy_set(free->neg, t1->neg, b->sz.sym_size);
-	  t1->nxt   = free->nxt;
-	  if(free == s->trans) s->trans = t1;
-	  free_btrans(free, 0, 0);
-	  state_trans--;
-	}
-	else if((flags & LTL2BA_SIMP_FLY) &&
-		(t1->to == to ) &&
-		included_set(t1->pos, t->pos, b->sz.sym_size) &&
-		included_set(t1->neg, t->neg, b->sz.sym_size)) /* t is redondant */
-	  break;
-	else
-	  t1 = t1->nxt;
-      }
-      if(t1 == s->trans) {
-	BTrans *trans = emalloc_btrans(b->sz.sym_size);
-	trans->to = to;
-	trans->to->incoming++;
-	copy_set(t->pos, trans->pos, b->sz.sym_size);
-	copy_set(t->neg, trans->neg, b->sz.sym_size);
-	trans->nxt = s->trans->nxt;
-	s->trans->nxt = trans;
-	state_trans++;
+    for(k = 0, t = s->gstate->trans->nxt; t != s->gstate->trans;
+        t = t->nxt, k++) {
+      BState *to = find_bstate(b, &t->to, e->final[k], s, bstack, ix);
+      if(e->kept[k]) { /* the last one kept comes first */
+        BTrans *trans = emalloc_btrans(b->sz.sym_size);
+        trans->to = to;
+        to->incoming++;
+        copy_set(t->pos, trans->pos, b->sz.sym_size);
+        copy_set(t->neg, trans->neg, b->sz.sym_size);
+        trans->nxt = s->trans->nxt;
+        s->trans->nxt = trans;
+        state_trans++;
       }
     }
 
@@ -464,9 +1097,6 @@ static void make_btrans(Buchi *b, BState *s, const int *final, Flags flags,
       s->prv = (BState *)0;
       s->nxt = bremoved->nxt;
       bremoved->nxt = s;
-      for(s1 = bremoved->nxt; s1 != bremoved; s1 = s1->nxt)
-	if(s1->prv == s)
-	  s1->prv = (BState *)0;
       return;
     }
     b->bstates->trans = s->trans;
@@ -480,9 +1110,6 @@ static void make_btrans(Buchi *b, BState *s, const int *final, Flags flags,
       s->prv = s1;
       s->nxt = bremoved->nxt;
       bremoved->nxt = s;
-      for(s1 = bremoved->nxt; s1 != bremoved; s1 = s1->nxt)
-	if(s1->prv == s)
-	  s1->prv = s->prv;
       return;
     }
   }
@@ -494,6 +1121,145 @@ static void make_btrans(Buchi *b, BState *s, const int *final, Flags flags,
   c->bstate_count++;
 }
 
+/********************************************************************\
+|*            Expansion of the Buchi states in parallel             *|
+\********************************************************************/
+
+/* the (generalized state, final value) pairs reachable from the initial
+ * state, expanded by several threads before mk_buchi() makes the states in
+ * its order and merges them on the fly */
+struct bexplore {
+  const Buchi *b;
+  const int *final;
+  Flags flags;
+  pthread_mutex_t lock;
+  pthread_cond_t more;  /* pairs were pushed, or a thread is done with one */
+  struct bxentry {
+    GState *gstate;     /* NULL if the slot is free */
+    int final;
+    struct bexpand *e;  /* NULL until expanded */
+  } *tab;
+  int size, used;       /* size is a power of 2 */
+  struct bxentry *todo; /* the pairs to expand */
+  int n_todo, max_todo;
+  int running;          /* threads expanding a pair */
+};
+
+static struct bxentry *bexplore_slot(const struct bexplore *x, GState *gstate,
+                                     int final)
+{
+  unsigned mask = x->size - 1, i;
+  for(i = bindex_hash(gstate, final) & mask; x->tab[i].gstate; i = (i + 1) & mask)
+    if(x->tab[i].gstate == gstate && x->tab[i].final == final)
+      break;
+  return &x->tab[i];
+}
+
+/* adds (gstate, final) to the pairs to expand, if it is new */
+static void bexplore_push(struct bexplore *x, GState *gstate, int final)
+{
+  struct bxentry *e = bexplore_slot(x, gstate, final);
+  if(e->gstate) return;
+  if(2 * ++x->used > x->size) { /* rehashes */
+    struct bxentry *old = x->tab;
+    int i, n = x->size;
+    x->size *= 2;
+    x->tab = calloc(x->size, sizeof(*x->tab));
+    if(!x->tab) fatal("not enough memory");
+    for(i = 0; i < n; i++)
+      if(old[i].gstate) *bexplore_slot(x, old[i].gstate, old[i].final) = old[i];
+    free(old);
+    e = bexplore_slot(x, gstate, final);
+  }
+  e->gstate = gstate;
+  e->final = final;
+  if(x->n_todo == x->max_todo &&
+     !(x->todo = realloc(x->todo, (x->max_todo = 2 * x->max_todo + 16) *
+                                  sizeof(*x->todo))))
+    fatal("not enough memory");
+  x->todo[x->n_todo++] = *e;
+}
+
+/* expands pairs until there are none left */
+static void bexplore_run(struct bexplore *x)
+{
+  GTrans *t;
+  int k;
+
+  pthread_mutex_lock(&x->lock);
+  for(;;) {
+    while(!x->n_todo && x->running)
+      pthread_cond_wait(&x->more, &x->lock);
+    if(!x->n_todo) /* and no thread can add some */
+      break;
+    struct bxentry p = x->todo[--x->n_todo];
+    x->running++;
+    pthread_mutex_unlock(&x->lock);
+
+    struct bexpand *e = expand_bstate(x->b, p.gstate, p.final, x->final,
+                                      x->flags);
+
+    pthread_mutex_lock(&x->lock);
+    bexplore_slot(x, p.gstate, p.final)->e = e;
+    if(p.gstate->trans)
+      for(k = 0, t = p.gstate->trans->nxt; t != p.gstate->trans;
+          t = t->nxt, k++)
+        if(e->kept[k])
+          bexplore_push(x, t->to, e->final[k]);
+    x->running--;
+    pthread_cond_broadcast(&x->more);
+  }
+  pthread_mutex_unlock(&x->lock);
+}
+
+static void bexplore_job(void *x)
+{
+  bexplore_run(x);
+}
+
+/* expands all the pairs reachable from the initial state in n threads */
+static struct bexplore *bexplore(const Buchi *b, const Generalized *g,
+                                 Flags flags, int n)
+{
+  struct bexplore *x = calloc(1, sizeof(*x));
+  GTrans *t;
+  int i;
+
+  if(!x || !(x->tab = calloc(x->size = 64, sizeof(*x->tab))))
+    fatal("not enough memory");
+  x->b = b;
+  x->final = g->final;
+  x->flags = flags;
+  pthread_mutex_init(&x->lock, NULL);
+  pthread_cond_init(&x->more, NULL);
+  for(i = 0; i < g->init_size; i++)
+    if(g->init[i])
+      for(t = g->init[i]->trans->nxt; t != g->init[i]->trans; t = t->nxt)
+        bexplore_push(x, t->to, next_final(b, t->final, 0, g->final));
+
+  run_in_threads(bexplore_job, x, n);
+  return x;
+}
+
+/* returns the expansion of (gstate, final), NULL if it was not reached */
+static struct bexpand *bexplore_find(const struct bexplore *x, GState *gstate,
+                                     int final)
+{
+  return bexplore_slot(x, gstate, final)->e;
+}
+
+static void free_bexplore(struct bexplore *x)
+{
+  int i;
+  for(i = 0; i < x->size; i++)
+    free(x->tab[i].e);
+  free(x->tab);
+  free(x->todo);
+  pthread_mutex_destroy(&x->lock);
+  pthread_cond_destroy(&x->more);
+  free(x);
+}
+
 /********************************************************************\
 |*                  Display of the Buchi automaton                  *|
 \********************************************************************/
@@ -681,6 +1447,16 @@ void print_dot_buchi(FILE *f, const Buchi *b, const char *const *sym_table, cons
   fprintf(f, "}\n");
 }
 
+/* returns the number of states of the automaton */
+static int count_bstates(const Buchi *b)
+{
+  BState *s;
+  int n = 0;
+  for(s = b->bstates->nxt; s != b->bstates; s = s->nxt)
+    n++;
+  return n;
+}
+
 /********************************************************************\
 |*                       Main method                                *|
 \********************************************************************/
@@ -698,7 +1474,10 @@ Buchi mk_buchi(Generalized *g, FILE *f, Flags flags, const char *const *sym_tabl
   struct bcounts cnts;
   memset(&cnts, 0, sizeof(cnts));
 
-  BState *bstack, *bremoved;
+  BState *bstack, *bremoved, *root;
+  struct bindex ix = { .size = 64, };
+  struct bexplore *x = NULL;
+  struct bexpand *e;
 
   if(flags & LTL2BA_STATS) getrusage(RUSAGE_SELF, &tr_debut);
 
@@ -706,6 +1485,7 @@ Buchi mk_buchi(Generalized *g, FILE *f, Flags flags, const char *const *sym_tabl
   bstack->nxt    = bstack;
   bremoved       = (BState *)tl_emalloc(sizeof(BState)); /* sentinel */
   bremoved->nxt  = bremoved;
+  ix.tab         = tl_emalloc(ix.size * sizeof(*ix.tab));
   b.bstates      = (BState *)tl_emalloc(sizeof(BState)); /* sentinel */
   b.bstates->nxt = s;
   b.bstates->prv = s;
@@ -722,7 +1502,7 @@ Buchi mk_buchi(Generalized *g, FILE *f, Flags flags, const char *const *sym_tabl
     if(g->init[i])
       for(t = g->init[i]->trans->nxt; t != g->init[i]->trans; t = t->nxt) {
 	int fin = next_final(&b, t->final, 0, g->final);
-	BState *to = find_bstate(&b, &t->to, fin, s, bstack, bremoved);
+	BState *to = find_bstate(&b, &t->to, fin, s, bstack, &ix);
 	for(t1 = s->trans->nxt; t1 != s->trans;) {
 	  if((flags & LTL2BA_SIMP_FLY) &&
 	     (to == t1->to) &&
@@ -756,15 +1536,27 @@ Buchi mk_buchi(Generalized *g, FILE *f, Flags flags, const char *const *sym_tabl
 	}
       }
 
+  if(ltl2ba_threads() > 1) /* the states are still made one by one below */
+    x = bexplore(&b, g, flags, ltl2ba_threads());
+
   while(bstack->nxt != bstack) { /* solves all states in the stack until it is empty */
     s = bstack->nxt;
     bstack->nxt = bstack->nxt->nxt;
     if(!s->incoming) {
+      bindex_del(&ix, s);
       free_bstate(s);
       continue;
     }
-    make_btrans(&b, s, g->final, flags, &cnts, bstack, bremoved);
+    if(!x || !(e = bexplore_find(x, s->gstate, s->final))) {
+      e = expand_bstate(&b, s->gstate, s->final, g->final, flags);
+      make_btrans(&b, s, e, flags, &cnts, bstack, bremoved, &ix);
+      free(e);
+    }
+    else
+      make_btrans(&b, s, e, flags, &cnts, bstack, bremoved, &ix);
   }
+  if(x) free_bexplore(x);
+  tfree(ix.tab);
 
   retarget_all_btrans(&b, bremoved);
 
@@ -784,12 +1576,31 @@ Buchi mk_buchi(Generalized *g, FILE *f, Flags flags, const char *const *sym_tabl
   }
 
   if(flags & LTL2BA_SIMP_DIFF) {
+    struct simp_deadline d;
+    int rounds = 0, stopped, sim_done = 0, states = 0;
+    simp_deadline_start(&d);
+    if(flags & LTL2BA_STATS) states = count_bstates(&b);
     simplify_btrans(&b, f, flags);
     if(flags & LTL2BA_SIMP_SCC) simplify_bscc(&b, bremoved);
-    while(simplify_bstates(&b, f, flags, &g->gstate_id, bremoved)) { /* simplifies as much as possible */
+    root = b.bstates->prv;
+    /* simplifies as much as possible, or until the budget is spent: the
+     * automaton is complete after each round */
+    while(!(stopped = simp_deadline_passed(&d)) &&
+          (rounds++, reduce_bstates(&b, f, flags, &g->gstate_id, bremoved,
+                                    &sim_done))) {
       simplify_btrans(&b, f, flags);
-      if(flags & LTL2BA_SIMP_SCC) simplify_bscc(&b, bremoved);
+      /* the scc marks are kept up to date by reduce_bstates() and no state
+       * becomes unreachable, unless the initial state is removed */
+      if((flags & LTL2BA_SIMP_SCC) && b.bstates->prv != root) {
+        simplify_bscc(&b, bremoved);
+        root = b.bstates->prv;
+      }
     }
+    if((flags & LTL2BA_STATS) && stopped)
+      fprintf(f, "\nSimplification of the Buchi automaton stopped after %i"
+                 " rounds and %i states removed, its budget of %i ms being"
+                 " spent\n",
+              rounds, states - count_bstates(&b), ltl2ba_simp_budget());
 
     if(flags & LTL2BA_VERBOSE) {
       fprintf(f, "\nBuchi automaton after simplification\n");
@@ -800,9 +1611,33 @@ Buchi mk_buchi(Generalized *g, FILE *f, Flags flags, const char *const *sym_tabl
     }
   }
 
+  tfree(bstack);
+  tfree(bremoved);
+
   return b;
 }
 
+/* frees the states and transitions of the Buchi automaton */
+void free_buchi(Buchi *b)
+{
+  BState *s;
+  BTrans *t;
+  while((s = b->bstates->nxt) != b->bstates) {
+    b->bstates->nxt = s->nxt;
+    while((t = s->trans->nxt) != s->trans) {
+      s->trans->nxt = t->nxt;
+      if(t->pos)
+        free_btrans(t, 0, 0);
+      else /* added by print_behaviours() */
+        tfree(t);
+    }
+    free_btrans(s->trans, 0, 0);
+    tfree(s);
+  }
+  tfree(b->bstates);
+  free_all_btrans(); /* the pooled sets have this automaton's sizes */
+}
+
 
 static void print_c_headers(FILE *f, const Cexprtab *cexpr,
                             const char *c_sym_name_prefix,
@@ -18,8 +18,8 @@ typedef struct Cache {
 	struct Cache *nxt;
 } Cache;
 
-static Cache	*stored = (Cache *) 0;
-static unsigned long	Caches, CacheHits;
+static TL_THREAD_LOCAL Cache	*stored = (Cache *) 0;
+static TL_THREAD_LOCAL unsigned long	Caches, CacheHits;
 
 static int ismatch(const Node *, const Node *);
 static int sameform(const Node *, const Node *);
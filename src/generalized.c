@@ -8,6 +8,8 @@
 
 #include "internal.h"
 
+#include <pthread.h>
+
 #undef min
 #define min(x,y)        ((x<y)?x:y)
 
@@ -19,17 +21,49 @@ struct gcounts {
   int gstate_count, gtrans_count;
 };
 
-typedef struct GScc {
-  GState *gstate;
-  int rank;
-  int theta;
-  struct GScc *nxt;
-} GScc;
-
+/* the depth-first search of gdfs(), by the rank of the states in it: while a
+ * state is on the stack, its 'incoming' field holds its rank */
 struct gdfs_state {
   int rank;
   int scc_id;
-  GScc *scc_stack;
+  GState **state;   /* the state of each rank */
+  GTrans **next;    /* its next transition to follow */
+  int *theta;       /* the lowest rank it reaches on the stack */
+  int *stack, size; /* the ranks in the current sccs */
+  int *on_stack;    /* set of these ranks */
+  int *path, depth; /* the ranks from the root to the current state */
+};
+
+/* the lists a state can be in while the automaton is built, in the order
+ * find_gstate() searches them */
+enum { G_STACK, G_SOLVED, G_REMOVED };
+
+struct gentry {
+  GState *s;        /* NULL if the slot is free */
+  unsigned h;       /* hash_set() of s->nodes_set */
+  int where, stamp; /* list of s, and when s was put at its head */
+};
+
+/* the states being built, by their set of alternating states */
+struct gindex {
+  struct gentry *tab;
+  int size, used;   /* size is a power of 2 */
+  int stamp, node_size;
+};
+
+/* a transition of a generalized state before its target is known */
+struct ptrans {
+  int *to, *final, *pos, *neg; /* follow the structure in memory */
+  int all_final;               /* final contains all the final states */
+  GState *state;               /* the target, once resolved */
+  struct ptrans *nxt;
+};
+
+/* the transitions of a generalized state, by its set of alternating states */
+struct gexpand {
+  struct ptrans **added; /* in the order they were added, */
+  int n_added;
+  struct ptrans *trans;  /* those which stayed, in the order of s->trans */
 };
 
 /********************************************************************\
@@ -55,13 +89,24 @@ static GState *remove_gstate(GState *s, GState *s1, GState *gremoved)
   s->nodes_set = 0;
   s->nxt = gremoved->nxt;
   gremoved->nxt = s;
-  s->prv = s1;
-  for(s1 = gremoved->nxt; s1 != gremoved; s1 = s1->nxt)
-    if(s1->prv == s)
-      s1->prv = s->prv;
+  s->prv = s1; /* followed by forward_gstate() */
   return prv;
 }
 
+/* returns the state which replaces a removed state, NULL if none does: the
+ * removed states form a forest by their 'prv' field, whose paths are shortened
+ * on the way */
+static GState *forward_gstate(GState *s)
+{
+  GState *r, *nxt;
+  for(r = s; r && !r->trans; r = r->prv);
+  for(; s != r; s = nxt) {
+    nxt = s->prv;
+    s->prv = r;
+  }
+  return r;
+}
+
 /* copies a transition */
 static void copy_gtrans(const set_sizes *sz, GTrans *from, GTrans *to)
 {
@@ -99,44 +144,65 @@ static int same_gtrans(const set_sizes *sz, GState *a, GTrans *s,
   return 1; /* same transitions up to acceptance conditions */
 }
 
-/* simplifies the transitions */
+/* simplifies the transitions: only transitions with the same target can make
+ * one another redundant, so each group of them is compared on its own */
 static int simplify_gtrans(Generalized *g, FILE *f, Flags flags, int *bad_scc)
 {
-  int changed = 0;
+  int changed = 0, n, max = 0, i, j, k, l;
   GState *s;
-  GTrans *t, *t1;
+  GTrans *t, *t1, **v = NULL;
+  struct trans_ref *r = NULL;
   struct rusage tr_debut, tr_fin;
   struct timeval t_diff;
 
   if(flags & LTL2BA_STATS) getrusage(RUSAGE_SELF, &tr_debut);
 
   for(s = g->gstates->nxt; s != g->gstates; s = s->nxt) {
-    t = s->trans->nxt;
-    while(t != s->trans) { /* tries to remove t */
-      copy_gtrans(&g->sz, t, s->trans);
-      t1 = s->trans->nxt;
-      while ( !((t != t1)
-          && (t1->to == t->to)
-          && included_set(t1->pos, t->pos, g->sz.sym_size)
-          && included_set(t1->neg, t->neg, g->sz.sym_size)
-          && (included_set(t->final, t1->final, g->sz.node_size)  /* acceptance conditions of t are also in t1 or may be ignored */
-              || ((flags & LTL2BA_SIMP_SCC) && ((s->incoming != t->to->incoming) || in_set(bad_scc, s->incoming))))) )
-        t1 = t1->nxt;
-      if(t1 != s->trans) { /* remove transition t */
-        GTrans *free = t->nxt;
-        t->to = free->to;
-        copy_set(free->pos, t->pos, g->sz.sym_size);
-        copy_set(free->neg, t->neg, g->sz.sym_size);
-        copy_set(free->final, t->final, g->sz.node_size);
-        t->nxt = free->nxt;
-        if(free == s->trans) s->trans = t;
-        free_gtrans(free, 0, 0);
-        changed++;
+    for(n = 0, t = s->trans->nxt; t != s->trans; t = t->nxt)
+      n++;
+    if(!n) continue;
+    if(n > max) {
+      if(v) { tfree(v); tfree(r); }
+      max = 2 * n;
+      v = (GTrans **)tl_emalloc(max * sizeof(*v));
+      r = (struct trans_ref *)tl_emalloc(max * sizeof(*r));
+    }
+    for(n = 0, t = s->trans->nxt; t != s->trans; t = t->nxt, n++) {
+      v[n] = t;
+      r[n].to = (uintptr_t)t->to;
+      r[n].i = n;
+    }
+    qsort(r, n, sizeof(*r), cmp_trans_ref);
+
+    for(i = 0; i < n; i = j) { /* the transitions to the same state as v[r[i].i] */
+      for(j = i + 1; j < n && r[j].to == r[i].to; j++);
+      for(k = i; k < j; k++) { /* tries to remove t */
+        t = v[r[k].i];
+        for(l = i; l < j; l++) {
+          t1 = v[r[l].i];
+          if((l != k) && t1
+             && included_set(t1->pos, t->pos, g->sz.sym_size)
+             && included_set(t1->neg, t->neg, g->sz.sym_size)
+             && (included_set(t->final, t1->final, g->sz.node_size)  /* acceptance conditions of t are also in t1 or may be ignored */
+                 || ((flags & LTL2BA_SIMP_SCC) && ((s->incoming != t->to->incoming) || in_set(bad_scc, s->incoming)))))
+            break;
+        }
+        if(l < j) { /* remove transition t */
+          v[r[k].i] = NULL;
+          free_gtrans(t, 0, 0);
+          changed++;
+        }
       }
-      else
-        t = t->nxt;
     }
+
+    for(t = s->trans, k = 0; k < n; k++) /* links the remaining ones in order */
+      if(v[k]) {
+        t->nxt = v[k];
+        t = v[k];
+      }
+    t->nxt = s->trans;
   }
+  if(v) { tfree(v); tfree(r); }
 
   if(flags & LTL2BA_STATS) {
     getrusage(RUSAGE_SELF, &tr_fin);
@@ -157,11 +223,11 @@ static void retarget_all_gtrans(Generalized *g, GState *gremoved)
   int i;
   for (i = 0; i < g->init_size; i++)
     if (g->init[i] && !g->init[i]->trans) /* init[i] has been removed */
-      g->init[i] = g->init[i]->prv;
+      g->init[i] = forward_gstate(g->init[i]);
   for (s = g->gstates->nxt; s != g->gstates; s = s->nxt)
     for (t = s->trans->nxt; t != s->trans; )
       if (!t->to->trans) { /* t->to has been removed */
-	t->to = t->to->prv;
+	t->to = forward_gstate(t->to);
 	if(!t->to) { /* t->to has no transitions */
 	  GTrans *free = t->nxt;
 	  t->to = free->to;
@@ -207,35 +273,111 @@ static int all_gtrans_match(const Generalized *g, GState *a, GState *b,
   return 1;
 }
 
-/* eliminates redundant states */
+static int cmp_unsigned(const void *a, const void *b)
+{
+  unsigned x = *(const unsigned *)a, y = *(const unsigned *)b;
+  return (x > y) - (x < y);
+}
+
+/* a hash of the set of targets and labels of the transitions of a state,
+ * without their acceptance conditions: states which all_gtrans_match() finds
+ * equivalent have the same. 'h' has room for all the transitions */
+static unsigned gstate_signature(const Generalized *g, GState *s, unsigned *h)
+{
+  GTrans *t;
+  unsigned sig = 0;
+  int i, n = 0;
+  for(t = s->trans->nxt; t != s->trans; t = t->nxt)
+    h[n++] = ((unsigned)((uintptr_t)t->to >> 4) * 0x01000193u ^
+              hash_set(t->pos, g->sz.sym_size)) * 0x01000193u ^
+             hash_set(t->neg, g->sz.sym_size);
+  qsort(h, n, sizeof(*h), cmp_unsigned);
+  for(i = 0; i < n; i++)
+    if(!i || h[i] != h[i - 1]) /* the same label may lead to the same state */
+      sig = (sig ^ h[i]) * 0x01000193u;
+  return sig;
+}
+
+/* a state and its position in the list of states, sorted by signature */
+struct gsig {
+  unsigned sig;
+  int i;
+};
+
+static int cmp_gsig(const void *a, const void *b)
+{
+  const struct gsig *x = a, *y = b;
+  if(x->sig != y->sig) return x->sig < y->sig ? -1 : 1;
+  return x->i - y->i;
+}
+
+/* eliminates redundant states: a state is only compared with the states
+ * after it whose transitions have the same signature */
 static int simplify_gstates(Generalized *g, FILE *f, Flags flags, int *bad_scc,
                             GState *gremoved)
 {
-  int changed = 0;
-  GState *a, *b;
+  int changed = 0, n = 0, max = 0, i, j, k, e;
+  GState *a, *b, **v;
+  GTrans *t;
+  struct gsig *sig;
+  int *rank;
+  unsigned *h;
   struct rusage tr_debut, tr_fin;
   struct timeval t_diff;
 
   if(flags & LTL2BA_STATS) getrusage(RUSAGE_SELF, &tr_debut);
 
   for(a = g->gstates->nxt; a != g->gstates; a = a->nxt) {
+    n++;
+    for(i = 0, t = a->trans->nxt; t != a->trans; t = t->nxt) i++;
+    if(i > max) max = i;
+  }
+  v = (GState **)tl_emalloc((n + 1) * sizeof(*v));
+  sig = (struct gsig *)tl_emalloc((n + 1) * sizeof(*sig));
+  rank = (int *)tl_emalloc((n + 1) * sizeof(*rank));
+  h = (unsigned *)tl_emalloc((max + 1) * sizeof(*h));
+  for(i = 0, a = g->gstates->nxt; a != g->gstates; a = a->nxt, i++) {
+    v[i] = a;
+    sig[i].sig = gstate_signature(g, a, h);
+    sig[i].i = i;
+  }
+  qsort(sig, n, sizeof(*sig), cmp_gsig);
+  for(k = 0; k < n; k++)
+    rank[sig[k].i] = k;
+
+  for(i = 0; i < n; i++) { /* v[i] is NULL once removed */
+    if(!(a = v[i])) continue;
     if(a->trans == a->trans->nxt) { /* a has no transitions */
-      a = remove_gstate(a, (GState *)0, gremoved);
+      remove_gstate(a, (GState *)0, gremoved);
+      v[i] = NULL;
       changed++;
       continue;
     }
-    g->gstates->trans = a->trans;
-    b = a->nxt;
-    while(!all_gtrans_match(g, a, b, (flags & LTL2BA_SIMP_SCC) != 0, bad_scc)) b = b->nxt;
-    if(b != g->gstates) { /* a and b are equivalent */
+    for(e = rank[i] + 1; e < n && sig[e].sig == sig[rank[i]].sig; e++);
+    for(k = rank[i] + 1; k < e; k++) /* the states of the same signature */
+      if(v[sig[k].i] &&
+         all_gtrans_match(g, a, v[sig[k].i], (flags & LTL2BA_SIMP_SCC) != 0,
+                          bad_scc))
+        break;
+    if(k < e) { /* a and b are equivalent */
+      j = sig[k].i;
+      b = v[j];
       /* if scc(a)>scc(b) and scc(a) is non-trivial then all_gtrans_match(a,b,use_scc) must fail */
-      if(a->incoming > b->incoming) /* scc(a) is trivial */
-        a = remove_gstate(a, b, gremoved);
-      else /* either scc(a)=scc(b) or scc(b) is trivial */
+      if(a->incoming > b->incoming) { /* scc(a) is trivial */
+        remove_gstate(a, b, gremoved);
+        v[i] = NULL;
+      }
+      else { /* either scc(a)=scc(b) or scc(b) is trivial */
         remove_gstate(b, a, gremoved);
+        v[j] = NULL;
+      }
       changed++;
     }
   }
+  tfree(v);
+  tfree(sig);
+  tfree(rank);
+  tfree(h);
   retarget_all_gtrans(g, gremoved);
 
   if(flags & LTL2BA_STATS) {
@@ -249,40 +391,51 @@ static int simplify_gstates(Generalized *g, FILE *f, Flags flags, int *bad_scc,
   return changed;
 }
 
-static int gdfs(GState *s, struct gdfs_state *st) {
+static void gdfs_push(GState *s, struct gdfs_state *st)
+{
+  int r = st->rank++;
+  st->state[r] = s;
+  st->next[r] = s->trans->nxt;
+  st->theta[r] = r;
+  st->stack[st->size++] = r;
+  add_set(st->on_stack, r);
+  st->path[st->depth++] = r;
+  s->incoming = r;
+}
+
+/* numbers the sccs reachable from s in the order they are completed */
+static void gdfs(GState *s, struct gdfs_state *st)
+{
   GTrans *t;
-  GScc *c;
-  GScc *scc = (GScc *)tl_emalloc(sizeof(GScc));
-  scc->gstate = s;
-  scc->rank = st->rank;
-  scc->theta = st->rank++;
-  scc->nxt = st->scc_stack;
-  st->scc_stack = scc;
-
-  s->incoming = 1;
-
-  for (t = s->trans->nxt; t != s->trans; t = t->nxt) {
-    if (t->to->incoming == 0) {
-      int result = gdfs(t->to, st);
-      scc->theta = min(scc->theta, result);
+  int r, x;
+
+  gdfs_push(s, st);
+  while(st->depth) {
+    r = st->path[st->depth - 1];
+    s = st->state[r];
+    if((t = st->next[r]) != s->trans) {
+      st->next[r] = t->nxt;
+      x = t->to->incoming;
+      if(x == 0)
+        gdfs_push(t->to, st);
+      else if(x < st->rank && in_set(st->on_stack, x) && st->state[x] == t->to)
+        st->theta[r] = min(st->theta[r], x);
+      continue;
     }
-    else {
-      for(c = st->scc_stack->nxt; c != 0; c = c->nxt)
-	if(c->gstate == t->to) {
-	  scc->theta = min(scc->theta, c->rank);
-	  break;
-	}
+    st->depth--; /* all the transitions of s are followed */
+    if(st->theta[r] == r) {
+      do {
+        x = st->stack[--st->size];
+        rem_set(st->on_stack, x);
+        st->state[x]->incoming = st->scc_id;
+      } while(x != r);
+      st->scc_id++;
     }
-  }
-  if(scc->rank == scc->theta) {
-    while(st->scc_stack != scc) {
-      st->scc_stack->gstate->incoming = st->scc_id;
-      st->scc_stack = st->scc_stack->nxt;
+    if(st->depth) {
+      x = st->path[st->depth - 1];
+      st->theta[x] = min(st->theta[x], st->theta[r]);
     }
-    scc->gstate->incoming = st->scc_id++;
-    st->scc_stack = scc->nxt;
   }
-  return scc->theta;
 }
 
 static void simplify_gscc(Generalized *g, int *final_set, int **bad_scc,
@@ -290,21 +443,37 @@ static void simplify_gscc(Generalized *g, int *final_set, int **bad_scc,
 {
   GState *s;
   GTrans *t;
-  int i, **scc_final;
+  int i, n = 0, **scc_final;
   struct gdfs_state st;
   st.rank = 1;
-  st.scc_stack = NULL;
   st.scc_id = 1;
+  st.size = 0;
+  st.depth = 0;
 
   if(g->gstates == g->gstates->nxt) return;
 
-  for(s = g->gstates->nxt; s != g->gstates; s = s->nxt)
+  for(s = g->gstates->nxt; s != g->gstates; s = s->nxt) {
     s->incoming = 0; /* state color = white */
+    n++;
+  }
+  st.state = (GState **)tl_emalloc((n + 1) * sizeof(*st.state));
+  st.next = (GTrans **)tl_emalloc((n + 1) * sizeof(*st.next));
+  st.theta = (int *)tl_emalloc((n + 1) * sizeof(*st.theta));
+  st.stack = (int *)tl_emalloc((n + 1) * sizeof(*st.stack));
+  st.path = (int *)tl_emalloc((n + 1) * sizeof(*st.path));
+  st.on_stack = make_set(-1, LTL2BA_SET_SIZE(n + 1));
 
   for(i = 0; i < g->init_size; i++)
     if(g->init[i] && g->init[i]->incoming == 0)
       gdfs(g->init[i], &st);
 
+  tfree(st.state);
+  tfree(st.next);
+  tfree(st.theta);
+  tfree(st.stack);
+  tfree(st.path);
+  tfree(st.on_stack);
+
   scc_final = (int **)tl_emalloc(st.scc_id * sizeof(int *));
   for(i = 0; i < st.scc_id; i++)
     scc_final[i] = make_set(-1,g->sz.node_size);
@@ -318,6 +487,7 @@ static void simplify_gscc(Generalized *g, int *final_set, int **bad_scc,
           merge_sets(scc_final[s->incoming], t->final, g->sz.node_size);
 
   g->scc_size = LTL2BA_SET_SIZE(st.scc_id + 1);
+  if(*bad_scc) tfree(*bad_scc);
   *bad_scc=make_set(-1, g->scc_size);
 
   for(i = 0; i < st.scc_id; i++)
@@ -333,51 +503,144 @@ static void simplify_gscc(Generalized *g, int *final_set, int **bad_scc,
 |*        Generation of the generalized Buchi automaton             *|
 \********************************************************************/
 
-/*is the transition final for i ?*/
-static int is_final(const set_sizes *sz, int *from, ATrans *at, int i,
-                    ATrans **transition, Flags flags)
+static void gindex_init(struct gindex *ix, int node_size)
 {
-  ATrans *t;
-  int in_to;
+  ix->size = 64;
+  ix->used = 0;
+  ix->stamp = 0;
+  ix->node_size = node_size;
+  ix->tab = tl_emalloc(ix->size * sizeof(*ix->tab));
+}
+
+static void gindex_put(struct gindex *ix, const struct gentry *e)
+{
+  unsigned mask = ix->size - 1, i;
+  for(i = e->h & mask; ix->tab[i].s; i = (i + 1) & mask);
+  ix->tab[i] = *e;
+}
+
+/* records that s was put at the head of the list 'where' */
+static void gindex_add(struct gindex *ix, GState *s, int where)
+{
+  struct gentry e = { s, hash_set(s->nodes_set, ix->node_size), where,
+                      ix->stamp++ };
+  if(2 * ++ix->used > ix->size) { /* rehashes */
+    struct gentry *old = ix->tab;
+    int i, n = ix->size;
+    ix->size *= 2;
+    ix->tab = tl_emalloc(ix->size * sizeof(*ix->tab));
+    for(i = 0; i < n; i++)
+      if(old[i].s) gindex_put(ix, &old[i]);
+    tfree(old);
+  }
+  gindex_put(ix, &e);
+}
+
+/* returns the slot of state s */
+static unsigned gindex_slot(const struct gindex *ix, GState *s)
+{
+  unsigned mask = ix->size - 1;
+  unsigned i = hash_set(s->nodes_set, ix->node_size) & mask;
+  while(ix->tab[i].s != s)
+    i = (i + 1) & mask;
+  return i;
+}
+
+/* records that s was moved to the head of the list 'where' */
+static void gindex_move(struct gindex *ix, GState *s, int where)
+{
+  struct gentry *e = &ix->tab[gindex_slot(ix, s)];
+  e->where = where;
+  e->stamp = ix->stamp++;
+}
+
+/* forgets s, before it is freed */
+static void gindex_del(struct gindex *ix, GState *s)
+{
+  unsigned mask = ix->size - 1, i = gindex_slot(ix, s), j, k;
+  for(j = i; ix->tab[j = (j + 1) & mask].s; ) {
+    k = ix->tab[j].h & mask; /* moves back the entries probed past i */
+    if((i < j) ? (k <= i || k > j) : (k <= i && k > j)) {
+      ix->tab[i] = ix->tab[j];
+      i = j;
+    }
+  }
+  ix->tab[i].s = NULL;
+  ix->used--;
+}
+
+/* returns the state find_gstate() would meet first in its lists, or NULL */
+static GState *gindex_find(const struct gindex *ix, int *set)
+{
+  unsigned mask = ix->size - 1, h = hash_set(set, ix->node_size), i;
+  const struct gentry *best = NULL;
+  for(i = h & mask; ix->tab[i].s; i = (i + 1) & mask) {
+    const struct gentry *e = &ix->tab[i];
+    if(e->h != h || !same_sets(set, e->s->nodes_set, ix->node_size))
+      continue;
+    if(!best || e->where < best->where ||
+       (e->where == best->where && e->stamp > best->stamp))
+      best = e;
+  }
+  return best ? best->s : NULL;
+}
+
+static int atrans_included(const set_sizes *sz, ATrans *a, ATrans *b)
+{
+  return included_set(a->to, b->to, sz->node_size) &&
+         included_set(a->pos, b->pos, sz->sym_size) &&
+         included_set(a->neg, b->neg, sz->sym_size);
+}
+
+/* the transitions of the final state g->final[k] which make a transition
+ * final for it: those not going back to it, and only the minimal ones */
+static ATrans **witnesses(const Generalized *g, const Alternating *alt,
+                          ATrans ***wit, int k)
+{
+  ATrans *t, *t2, **w;
+  int n = 0, before, f = g->final[k];
+  if(wit[k]) return wit[k];
+  for(t = get_atrans(alt, f); t; t = t->nxt) n++;
+  w = wit[k] = (ATrans **)tl_emalloc((n + 1) * sizeof(ATrans *));
+  n = 0;
+  for(t = get_atrans(alt, f); t; t = t->nxt) {
+    if(in_set(t->to, f)) continue;
+    before = 1; /* of equal transitions, the first one is kept */
+    for(t2 = get_atrans(alt, f); t2; t2 = t2->nxt) {
+      if(t2 == t) { before = 0; continue; }
+      if(!in_set(t2->to, f) && atrans_included(&g->sz, t2, t) &&
+         (before || !atrans_included(&g->sz, t, t2)))
+        break;
+    }
+    if(!t2) w[n++] = t;
+  }
+  w[n] = NULL;
+  return w;
+}
+
+/*is the transition final for g->final[k] ?*/
+static int is_final(const Generalized *g, int *from, ATrans *at, int k,
+                    const Alternating *alt, ATrans ***wit, Flags flags)
+{
+  ATrans **w;
+  int i = g->final[k];
   if(((flags & LTL2BA_FJTOFJ) && !in_set(at->to, i)) ||
     (!(flags & LTL2BA_FJTOFJ) && !in_set(from,  i))) return 1;
-  in_to = in_set(at->to, i);
-  rem_set(at->to, i);
-  for(t = transition[i]; t; t = t->nxt)
-    if(included_set(t->to, at->to, sz->node_size) &&
-       included_set(t->pos, at->pos, sz->sym_size) &&
-       included_set(t->neg, at->neg, sz->sym_size)) {
-      if(in_to) add_set(at->to, i);
-      return 1;
-    }
-  if(in_to) add_set(at->to, i);
+  /* no witness goes to i, which need not be removed from at->to */
+  for(w = witnesses(g, alt, wit, k); *w; w++)
+    if(atrans_included(&g->sz, *w, at)) return 1;
   return 0;
 }
 
 /* finds the corresponding state, or creates it */
 static GState *find_gstate(Generalized *g, int *set, GState *s, GState *gstack,
-                           GState *gremoved)
+                           struct gindex *ix)
 {
 
   if(same_sets(set, s->nodes_set, g->sz.node_size)) return s; /* same state */
 
-  s = gstack->nxt; /* in the stack */
-  gstack->nodes_set = set;
-  while(!same_sets(set, s->nodes_set, g->sz.node_size))
-    s = s->nxt;
-  if(s != gstack) return s;
-
-  s = g->gstates->nxt; /* in the solved states */
-  g->gstates->nodes_set = set;
-  while(!same_sets(set, s->nodes_set, g->sz.node_size))
-    s = s->nxt;
-  if(s != g->gstates) return s;
-
-  s = gremoved->nxt; /* in the removed states */
-  gremoved->nodes_set = set;
-  while(!same_sets(set, s->nodes_set, g->sz.node_size))
-    s = s->nxt;
-  if(s != gremoved) return s;
+  /* in the stack, in the solved states or in the removed states */
+  if((s = gindex_find(ix, set))) return s;
 
   s = (GState *)tl_emalloc(sizeof(GState)); /* creates a new state */
   s->id = (empty_set(set, g->sz.node_size)) ? 0 : g->gstate_id++;
@@ -387,18 +650,50 @@ static GState *find_gstate(Generalized *g, int *set, GState *s, GState *gstack,
   s->trans->nxt = s->trans;
   s->nxt = gstack->nxt;
   gstack->nxt = s;
+  gindex_add(ix, s, G_STACK);
   return s;
 }
 
-/* creates all the transitions from a state */
-static void make_gtrans(Generalized *g, GState *s, ATrans **transition,
-                        Flags flags, int *fin, struct gcounts *c,
-                        int *bad_scc, GState *gstack, GState *gremoved)
+/* tells if all the transitions completing the partial product 'at' of the
+ * state 'set' would be found redundant: a transition kept so far is included
+ * in at, and all of them and it are final for every final state */
+static int subsumed(const Generalized *g, int *set, ATrans *at,
+                    const struct gexpand *e, const Alternating *alt,
+                    ATrans ***wit, Flags flags)
 {
-  int i, *list, state_trans = 0, trans_exist = 1;
-  GState *s1;
+  struct ptrans *t2;
+  ATrans **w;
+  int k;
+
+  if(!(flags & LTL2BA_SIMP_FLY)) return 0;
+  for(t2 = e->trans; t2; t2 = t2->nxt)
+    if(t2->all_final &&
+       included_set(t2->to, at->to, g->sz.node_size) &&
+       included_set(t2->pos, at->pos, g->sz.sym_size) &&
+       included_set(t2->neg, at->neg, g->sz.sym_size))
+      break;
+  if(!t2) return 0;
+
+  /* as in is_final(), but only what no larger product can change */
+  for(k = 1; k < g->final[0]; k++) {
+    if(!(flags & LTL2BA_FJTOFJ) && !in_set(set, g->final[k])) continue;
+    for(w = witnesses(g, alt, wit, k); *w; w++)
+      if(atrans_included(&g->sz, *w, at)) break;
+    if(!*w) return 0;
+  }
+  return 1;
+}
+
+/* computes the transitions of a state whose set of alternating states is
+ * 'set', as make_gtrans() adds them: this only depends on the set */
+static void expand_gstate(const Generalized *g, int *set, const Alternating *alt,
+                          ATrans ***wit, Flags flags, int *fin,
+                          struct gexpand *e)
+{
+  int i, *list, n = 0, trans_exist = 1;
+  int w = 2 * g->sz.node_size + 2 * g->sz.sym_size;
   ATrans *t1;
-  AProd *prod = (AProd *)tl_emalloc(sizeof(AProd)); /* initialization */
+  AProd *p, *prod = (AProd *)tl_emalloc(sizeof(AProd)); /* initialization */
   prod->nxt = prod;
   prod->prv = prod;
   prod->prod = emalloc_atrans(g->sz.sym_size, g->sz.node_size);
@@ -407,12 +702,15 @@ static void make_gtrans(Generalized *g, GState *s, ATrans **transition,
   clear_set(prod->prod->neg, g->sz.sym_size);
   prod->trans = prod->prod;
   prod->trans->nxt = prod->prod;
-  list = list_set(s->nodes_set, g->sz.node_size);
+  list = list_set(set, g->sz.node_size);
+  e->added = NULL;
+  e->n_added = 0;
+  e->trans = NULL;
 
   for(i = 1; i < list[0]; i++) {
-    AProd *p = (AProd *)tl_emalloc(sizeof(AProd));
+    p = (AProd *)tl_emalloc(sizeof(AProd));
     p->astate = list[i];
-    p->trans = transition[list[i]];
+    p->trans = get_atrans(alt, list[i]);
     if(!p->trans) trans_exist = 0;
     p->prod = merge_trans(&g->sz, prod->nxt->prod, p->trans);
     p->nxt = prod->nxt;
@@ -421,80 +719,127 @@ static void make_gtrans(Generalized *g, GState *s, ATrans **transition,
     p->prv->nxt = p;
   }
 
+  /* the products are made from the last digit of the odometer on: starts at
+   * the last one which is empty, if any */
+  for(p = prod->prv; p != prod && p->prod; p = p->prv);
+
   while(trans_exist) { /* calculates all the transitions */
-    AProd *p = prod->nxt;
-    t1 = p->prod;
-    if(t1) { /* solves the current transition */
-      GTrans *trans, *t2;
+    if(p == prod) { /* solves the current transition */
+      struct ptrans *t2, **pt2 = &e->trans;
+      t1 = prod->nxt->prod;
       clear_set(fin, g->sz.node_size);
       for(i = 1; i < g->final[0]; i++)
-	if(is_final(&g->sz, s->nodes_set, t1, g->final[i], transition, flags))
+	if(is_final(g, set, t1, i, alt, wit, flags))
 	  add_set(fin, g->final[i]);
-      for(t2 = s->trans->nxt; t2 != s->trans;) {
+      while((t2 = *pt2)) {
 	if((flags & LTL2BA_SIMP_FLY) &&
-	   included_set(t1->to, t2->to->nodes_set, g->sz.node_size) &&
+	   included_set(t1->to, t2->to, g->sz.node_size) &&
 	   included_set(t1->pos, t2->pos, g->sz.sym_size) &&
 	   included_set(t1->neg, t2->neg, g->sz.sym_size) &&
 	   same_sets(fin, t2->final, g->sz.node_size)) { /* t2 is redondant */
-	  GTrans *free = t2->nxt;
-	  t2->to->incoming--;
-	  t2->to = free->to;
-	  copy_set(free->pos, t2->pos, g->sz.sym_size);
-	  copy_set(free->neg, t2->neg, g->sz.sym_size);
-	  copy_set(free->final, t2->final, g->sz.node_size);
-	  t2->nxt   = free->nxt;
-	  if(free == s->trans) s->trans = t2;
-	  free_gtrans(free, 0, 0);
-	  state_trans--;
+	  *pt2 = t2->nxt;
 	}
 	else if((flags & LTL2BA_SIMP_FLY) &&
-		included_set(t2->to->nodes_set, t1->to, g->sz.node_size) &&
+		included_set(t2->to, t1->to, g->sz.node_size) &&
 		included_set(t2->pos, t1->pos, g->sz.sym_size) &&
 		included_set(t2->neg, t1->neg, g->sz.sym_size) &&
 		same_sets(t2->final, fin, g->sz.node_size)) {/* t1 is redondant */
 	  break;
 	}
 	else {
-	  t2 = t2->nxt;
+	  pt2 = &t2->nxt;
 	}
       }
-      if(t2 == s->trans) { /* adds the transition */
-	trans = emalloc_gtrans(g->sz.sym_size, g->sz.node_size);
-	trans->to = find_gstate(g, t1->to, s, gstack, gremoved);
-	trans->to->incoming++;
-	copy_set(t1->pos, trans->pos, g->sz.sym_size);
-	copy_set(t1->neg, trans->neg, g->sz.sym_size);
-	copy_set(fin,   trans->final, g->sz.node_size);
-	trans->nxt = s->trans->nxt;
-	s->trans->nxt = trans;
-	state_trans++;
+      if(!t2) { /* adds the transition */
+	/* the expansion may be made and used in different threads */
+	t2 = malloc(sizeof(*t2) + w * sizeof(int));
+	if(!t2 || (e->n_added == n &&
+	           !(e->added = realloc(e->added,
+	                                (n = 2 * n + 4) * sizeof(*e->added)))))
+	  fatal("not enough memory");
+	t2->to    = (int *)(t2 + 1);
+	t2->final = t2->to + g->sz.node_size;
+	t2->pos   = t2->final + g->sz.node_size;
+	t2->neg   = t2->pos + g->sz.sym_size;
+	copy_set(t1->to,  t2->to,    g->sz.node_size);
+	copy_set(t1->pos, t2->pos,   g->sz.sym_size);
+	copy_set(t1->neg, t2->neg,   g->sz.sym_size);
+	copy_set(fin,     t2->final, g->sz.node_size);
+	t2->all_final = card_set(fin, g->sz.node_size) == g->final[0] - 1;
+	t2->nxt = e->trans;
+	e->trans = t2;
+	e->added[e->n_added++] = t2;
       }
+      p = prod->nxt;
     }
-    if(!p->trans)
-      break;
-    while(!p->trans->nxt) /* calculates the next transition */
+    /* calculates the next transition: advances digit p, or the first one
+     * after it which has a next transition */
+    while(p != prod && !p->trans->nxt)
       p = p->nxt;
     if(p == prod)
       break;
     p->trans = p->trans->nxt;
     do_merge_trans(&g->sz, &(p->prod), p->nxt->prod, p->trans);
-    p = p->prv;
-    while(p != prod) {
-      p->trans = transition[p->astate];
+    /* a partial product which is inconsistent, or whose transitions would
+     * all be redundant, is not completed: the next one is taken instead */
+    if(!p->prod ||
+       (p != prod->nxt && subsumed(g, set, p->prod, e, alt, wit, flags)))
+      continue;
+    for(p = p->prv; p != prod; p = p->prv) {
+      p->trans = get_atrans(alt, p->astate);
       do_merge_trans(&g->sz, &(p->prod), p->nxt->prod, p->trans);
-      p = p->prv;
+      if(!p->prod ||
+         (p != prod->nxt && subsumed(g, set, p->prod, e, alt, wit, flags)))
+        break;
     }
   }
 
   tfree(list); /* free memory */
   while(prod->nxt != prod) {
-    AProd *p = prod->nxt;
+    p = prod->nxt;
     prod->nxt = p->nxt;
     free_atrans(p->prod, 0);
     tfree(p);
   }
   free_atrans(prod->prod, 0);
   tfree(prod);
+}
+
+static void free_gexpand(struct gexpand *e)
+{
+  int i;
+  for(i = 0; i < e->n_added; i++)
+    free(e->added[i]);
+  free(e->added);
+}
+
+/* creates all the transitions from a state, as computed by expand_gstate() */
+static void make_gtrans(Generalized *g, GState *s, const struct gexpand *e,
+                        Flags flags, struct gcounts *c,
+                        int *bad_scc, GState *gstack, GState *gremoved,
+                        struct gindex *ix)
+{
+  int i, state_trans = 0;
+  GState *s1;
+  GTrans *last = s->trans;
+  struct ptrans *t;
+
+  /* a transition found redundant later still created its target */
+  for(i = 0; i < e->n_added; i++)
+    e->added[i]->state = find_gstate(g, e->added[i]->to, s, gstack, ix);
+
+  for(t = e->trans; t; t = t->nxt) {
+    GTrans *trans = emalloc_gtrans(g->sz.sym_size, g->sz.node_size);
+    trans->to = t->state;
+    trans->to->incoming++;
+    copy_set(t->pos,   trans->pos,   g->sz.sym_size);
+    copy_set(t->neg,   trans->neg,   g->sz.sym_size);
+    copy_set(t->final, trans->final, g->sz.node_size);
+    trans->nxt = s->trans;
+    last->nxt = trans;
+    last = trans;
+    state_trans++;
+  }
 
   if(flags & LTL2BA_SIMP_FLY) {
     if(s->trans == s->trans->nxt) { /* s has no transitions */
@@ -503,9 +848,7 @@ static void make_gtrans(Generalized *g, GState *s, ATrans **transition,
       s->prv = (GState *)0;
       s->nxt = gremoved->nxt;
       gremoved->nxt = s;
-      for(s1 = gremoved->nxt; s1 != gremoved; s1 = s1->nxt)
-	if(s1->prv == s)
-	s1->prv = (GState *)0;
+      gindex_move(ix, s, G_REMOVED);
       return;
     }
 
@@ -519,9 +862,7 @@ static void make_gtrans(Generalized *g, GState *s, ATrans **transition,
       s->prv = s1;
       s->nxt = gremoved->nxt;
       gremoved->nxt = s;
-      for(s1 = gremoved->nxt; s1 != gremoved; s1 = s1->nxt)
-	if(s1->prv == s)
-	  s1->prv = s->prv;
+      gindex_move(ix, s, G_REMOVED);
       return;
     }
   }
@@ -530,10 +871,153 @@ static void make_gtrans(Generalized *g, GState *s, ATrans **transition,
   s->prv = g->gstates;
   s->nxt->prv = s;
   g->gstates->nxt = s;
+  gindex_move(ix, s, G_SOLVED);
   c->gtrans_count += state_trans;
   c->gstate_count++;
 }
 
+/********************************************************************\
+|*          Expansion of the generalized states in parallel         *|
+\********************************************************************/
+
+/* the sets of alternating states reachable from the initial ones, expanded by
+ * several threads before mk_generalized() makes the states in its order */
+struct gexplore {
+  const Generalized *g;
+  const Alternating *alt;
+  ATrans ***wit;        /* all computed before the threads start */
+  Flags flags;
+  pthread_mutex_t lock;
+  pthread_cond_t more;  /* sets were pushed, or a thread is done with one */
+  struct gxentry {
+    int *set;           /* NULL if the slot is free */
+    unsigned h;
+    struct gexpand *e;  /* NULL until expanded */
+  } *tab;
+  int size, used;       /* size is a power of 2 */
+  int **todo;           /* the sets to expand */
+  int n_todo, max_todo;
+  int running;          /* threads expanding a set */
+};
+
+static struct gxentry *gexplore_slot(const struct gexplore *x, int *set,
+                                     unsigned h)
+{
+  unsigned mask = x->size - 1, i;
+  for(i = h & mask; x->tab[i].set; i = (i + 1) & mask)
+    if(x->tab[i].h == h && same_sets(set, x->tab[i].set, x->g->sz.node_size))
+      break;
+  return &x->tab[i];
+}
+
+/* adds set to the sets to expand, if it is new */
+static void gexplore_push(struct gexplore *x, int *set)
+{
+  unsigned h = hash_set(set, x->g->sz.node_size);
+  struct gxentry *e = gexplore_slot(x, set, h);
+  if(e->set) return;
+  if(2 * ++x->used > x->size) { /* rehashes */
+    struct gxentry *old = x->tab;
+    int i, n = x->size;
+    x->size *= 2;
+    x->tab = calloc(x->size, sizeof(*x->tab));
+    if(!x->tab) fatal("not enough memory");
+    for(i = 0; i < n; i++)
+      if(old[i].set) *gexplore_slot(x, old[i].set, old[i].h) = old[i];
+    free(old);
+    e = gexplore_slot(x, set, h);
+  }
+  e->set = set;
+  e->h = h;
+  if(x->n_todo == x->max_todo &&
+     !(x->todo = realloc(x->todo, (x->max_todo = 2 * x->max_todo + 16) *
+                                  sizeof(*x->todo))))
+    fatal("not enough memory");
+  x->todo[x->n_todo++] = set;
+}
+
+/* expands sets until there are none left */
+static void gexplore_run(struct gexplore *x)
+{
+  int *fin = new_set(x->g->sz.node_size);
+  struct ptrans *t;
+
+  pthread_mutex_lock(&x->lock);
+  for(;;) {
+    while(!x->n_todo && x->running)
+      pthread_cond_wait(&x->more, &x->lock);
+    if(!x->n_todo) /* and no thread can add some */
+      break;
+    int *set = x->todo[--x->n_todo];
+    x->running++;
+    pthread_mutex_unlock(&x->lock);
+
+    struct gexpand *e = malloc(sizeof(*e));
+    if(!e) fatal("not enough memory");
+    expand_gstate(x->g, set, x->alt, x->wit, x->flags, fin, e);
+
+    pthread_mutex_lock(&x->lock);
+    gexplore_slot(x, set, hash_set(set, x->g->sz.node_size))->e = e;
+    for(t = e->trans; t; t = t->nxt)
+      gexplore_push(x, t->to);
+    x->running--;
+    pthread_cond_broadcast(&x->more);
+  }
+  pthread_mutex_unlock(&x->lock);
+  tfree(fin);
+}
+
+static void gexplore_job(void *x)
+{
+  gexplore_run(x);
+}
+
+/* expands all the sets reachable from the initial ones in n threads */
+static struct gexplore *gexplore(const Generalized *g, const Alternating *alt,
+                                 ATrans ***wit, Flags flags, int n)
+{
+  struct gexplore *x = calloc(1, sizeof(*x));
+  ATrans *t;
+  int k;
+
+  if(!x || !(x->tab = calloc(x->size = 64, sizeof(*x->tab))))
+    fatal("not enough memory");
+  x->g = g;
+  x->alt = alt;
+  x->wit = wit;
+  x->flags = flags;
+  for(k = 1; k < g->final[0]; k++)
+    witnesses(g, alt, wit, k);
+  pthread_mutex_init(&x->lock, NULL);
+  pthread_cond_init(&x->more, NULL);
+  for(t = alt->transition[0]; t; t = t->nxt)
+    gexplore_push(x, t->to);
+
+  run_in_threads(gexplore_job, x, n);
+  return x;
+}
+
+/* returns the expansion of set, NULL if it was not reached */
+static struct gexpand *gexplore_find(const struct gexplore *x, int *set)
+{
+  return gexplore_slot(x, set, hash_set(set, x->g->sz.node_size))->e;
+}
+
+static void free_gexplore(struct gexplore *x)
+{
+  int i;
+  for(i = 0; i < x->size; i++)
+    if(x->tab[i].e) {
+      free_gexpand(x->tab[i].e);
+      free(x->tab[i].e);
+    }
+  free(x->tab);
+  free(x->todo);
+  pthread_mutex_destroy(&x->lock);
+  pthread_cond_destroy(&x->more);
+  free(x);
+}
+
 /********************************************************************\
 |*            Display of the generalized Buchi automaton            *|
 \********************************************************************/
@@ -576,6 +1060,16 @@ static void print_generalized(FILE *f, const char *const *sym_table,
   reverse_print_generalized(f, sym_table, cexpr, g, g->gstates->nxt);
 }
 
+/* returns the number of states of the automaton */
+static int count_gstates(const Generalized *g)
+{
+  GState *s;
+  int n = 0;
+  for(s = g->gstates->nxt; s != g->gstates; s = s->nxt)
+    n++;
+  return n;
+}
+
 /********************************************************************\
 |*                       Main method                                *|
 \********************************************************************/
@@ -589,6 +1083,11 @@ Generalized mk_generalized(const Alternating *alt, FILE * tl_out, Flags flags,
   struct timeval t_diff;
   struct gcounts cnts;
   memset(&cnts, 0, sizeof(cnts));
+  struct gindex ix;
+  struct gexpand e, *ep;
+  struct gexplore *x = NULL;
+  ATrans ***wit; /* by final state, computed on demand by witnesses() */
+  int k;
 
   Generalized g = { .gstate_id = 1, .sz = alt->sz, };
 
@@ -597,6 +1096,7 @@ Generalized mk_generalized(const Alternating *alt, FILE * tl_out, Flags flags,
   int *fin = new_set(g.sz.node_size);
   int *bad_scc = NULL; /* will be initialized in simplify_gscc */
   g.final = list_set(alt->final_set, g.sz.node_size);
+  wit = (ATrans ***)tl_emalloc(g.final[0] * sizeof(ATrans **));
 
   gstack         = (GState *)tl_emalloc(sizeof(GState)); /* sentinel */
   gstack->nxt    = gstack;
@@ -605,6 +1105,7 @@ Generalized mk_generalized(const Alternating *alt, FILE * tl_out, Flags flags,
   g.gstates      = (GState *)tl_emalloc(sizeof(GState)); /* sentinel */
   g.gstates->nxt = g.gstates;
   g.gstates->prv = g.gstates;
+  gindex_init(&ix, g.sz.node_size);
 
   for(t = alt->transition[0]; t; t = t->nxt) { /* puts initial states in the stack */
     s = (GState *)tl_emalloc(sizeof(GState));
@@ -615,6 +1116,7 @@ Generalized mk_generalized(const Alternating *alt, FILE * tl_out, Flags flags,
     s->trans->nxt = s->trans;
     s->nxt = gstack->nxt;
     gstack->nxt = s;
+    gindex_add(&ix, s, G_STACK);
     g.init_size++;
   }
 
@@ -623,15 +1125,30 @@ Generalized mk_generalized(const Alternating *alt, FILE * tl_out, Flags flags,
   for(s = gstack->nxt; s != gstack; s = s->nxt)
     g.init[g.init_size++] = s;
 
+  /* a lazy alternating automaton is completed by the expansions */
+  if(ltl2ba_threads() > 1 && !alt->lazy)
+    x = gexplore(&g, alt, wit, flags, ltl2ba_threads());
+
   while(gstack->nxt != gstack) { /* solves all states in the stack until it is empty */
     s = gstack->nxt;
     gstack->nxt = gstack->nxt->nxt;
     if(!s->incoming) {
+      gindex_del(&ix, s);
       free_gstate(s);
       continue;
     }
-    make_gtrans(&g, s, alt->transition, flags, fin, &cnts, bad_scc, gstack, gremoved);
+    if(!x || !(ep = gexplore_find(x, s->nodes_set))) {
+      expand_gstate(&g, s->nodes_set, alt, wit, flags, fin, &e);
+      ep = &e;
+    }
+    make_gtrans(&g, s, ep, flags, &cnts, bad_scc, gstack, gremoved, &ix);
+    if(ep == &e) free_gexpand(&e);
   }
+  if(x) free_gexplore(x);
+  tfree(ix.tab);
+  for(k = 1; k < g.final[0]; k++)
+    if(wit[k]) tfree(wit[k]);
+  tfree(wit);
 
   retarget_all_gtrans(&g, gremoved);
 
@@ -641,6 +1158,7 @@ Generalized mk_generalized(const Alternating *alt, FILE * tl_out, Flags flags,
     fprintf(tl_out, "\nBuilding the generalized Buchi automaton : %ld.%06lis",
 		t_diff.tv_sec, t_diff.tv_usec);
     fprintf(tl_out, "\n%i states, %i transitions\n", cnts.gstate_count, cnts.gtrans_count);
+    if(alt->lazy) lazy_stats(tl_out, alt);
   }
 
   tfree(gstack);
@@ -651,14 +1169,28 @@ Generalized mk_generalized(const Alternating *alt, FILE * tl_out, Flags flags,
   }
 
   if(flags & LTL2BA_SIMP_DIFF) {
+    struct simp_deadline d;
+    int rounds = 0, stopped, states = 0;
+    simp_deadline_start(&d);
+    if(flags & LTL2BA_STATS) states = count_gstates(&g);
+    /* the sccs are only computed again if the transitions changed: removing
+     * some may change the order in which the sccs are numbered */
     if (flags & LTL2BA_SIMP_SCC) simplify_gscc(&g, alt->final_set, &bad_scc, gremoved);
-    simplify_gtrans(&g, tl_out, flags, bad_scc);
-    if (flags & LTL2BA_SIMP_SCC) simplify_gscc(&g, alt->final_set, &bad_scc, gremoved);
-    while(simplify_gstates(&g, tl_out, flags, bad_scc, gremoved)) { /* simplifies as much as possible */
-      if (flags & LTL2BA_SIMP_SCC) simplify_gscc(&g, alt->final_set, &bad_scc, gremoved);
-      simplify_gtrans(&g, tl_out, flags, bad_scc);
+    if (simplify_gtrans(&g, tl_out, flags, bad_scc) && (flags & LTL2BA_SIMP_SCC))
+      simplify_gscc(&g, alt->final_set, &bad_scc, gremoved);
+    /* simplifies as much as possible, or until the budget is spent: the
+     * automaton is complete after each round */
+    while(!(stopped = simp_deadline_passed(&d)) &&
+          (rounds++, simplify_gstates(&g, tl_out, flags, bad_scc, gremoved))) {
       if (flags & LTL2BA_SIMP_SCC) simplify_gscc(&g, alt->final_set, &bad_scc, gremoved);
+      if (simplify_gtrans(&g, tl_out, flags, bad_scc) && (flags & LTL2BA_SIMP_SCC))
+        simplify_gscc(&g, alt->final_set, &bad_scc, gremoved);
     }
+    if((flags & LTL2BA_STATS) && stopped)
+      fprintf(tl_out, "\nSimplification of the generalized Buchi automaton stopped"
+                      " after %i rounds and %i states removed, its budget of %i"
+                      " ms being spent\n",
+              rounds, states - count_gstates(&g), ltl2ba_simp_budget());
 
     if(flags & LTL2BA_VERBOSE) {
       fprintf(tl_out, "\nGeneralized Buchi automaton after simplification\n");
@@ -666,6 +1198,26 @@ Generalized mk_generalized(const Alternating *alt, FILE * tl_out, Flags flags,
     }
   }
 
+  tfree(fin);
+  if(bad_scc) tfree(bad_scc);
+  tfree(gremoved);
+
   return g;
 }
 
+/* frees the states and transitions of the generalized Buchi automaton */
+void free_generalized(Generalized *g)
+{
+  GState *s;
+  while((s = g->gstates->nxt) != g->gstates) {
+    g->gstates->nxt = s->nxt;
+    free_gtrans(s->trans->nxt, s->trans, 0);
+    tfree(s->nodes_set);
+    tfree(s);
+  }
+  tfree(g->gstates);
+  if(g->init) tfree(g->init);
+  tfree(g->final);
+  free_all_gtrans(); /* the pooled sets have this automaton's sizes */
+}
+
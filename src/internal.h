@@ -2,8 +2,10 @@
 #include <ltl2ba.h>
 
 #include <assert.h>
+#include <stdint.h>
 #include <string.h>
 #include <sys/time.h>
+#include <time.h>
 #include <sys/resource.h>
 
 #define True       tl_nn(TRUE, NULL, NULL)
@@ -24,6 +26,10 @@
 
 #undef TL_EMALLOC_VERBOSE
 
+/* The memory pools, the rewrite cache and the driver's parser state are kept
+ * per thread, so that independent formulas can be translated concurrently. */
+#define TL_THREAD_LOCAL _Thread_local
+
 typedef ltl2ba_Symbol      Symbol;
 typedef ltl2ba_Node        Node;
 typedef ltl2ba_ATrans      ATrans;
@@ -70,8 +76,73 @@ timeval_subtract(struct timeval *result, struct timeval *x, struct timeval *y)
 	result->tv_usec = x->tv_usec - y->tv_usec;
 }
 
+/* the end of the time given to simplify an automaton, if any, see
+ * ltl2ba_set_simp_budget() */
+struct simp_deadline {
+	struct timespec end;
+	int on;
+};
+
+static inline void simp_deadline_start(struct simp_deadline *d)
+{
+	long ms = ltl2ba_simp_budget();
+	if (!(d->on = ms > 0))
+		return;
+	clock_gettime(CLOCK_MONOTONIC, &d->end);
+	d->end.tv_sec += ms / 1000;
+	d->end.tv_nsec += ms % 1000 * 1000000L;
+	if (d->end.tv_nsec >= 1000000000L) {
+		d->end.tv_nsec -= 1000000000L;
+		d->end.tv_sec++;
+	}
+}
+
+static inline int simp_deadline_passed(const struct simp_deadline *d)
+{
+	struct timespec now;
+	if (!d->on)
+		return 0;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec > d->end.tv_sec ||
+	       (now.tv_sec == d->end.tv_sec && now.tv_nsec >= d->end.tv_nsec);
+}
+
+/* runs fn(arg) in the calling thread and in at most n - 1 helper threads,
+ * which are kept for its next calls, and returns once all of them are done */
+void run_in_threads(void (*fn)(void *), void *arg, int n);
+
+/* returns the index of C expression s in cexpr, adding it if it is new */
+int cexpr_lookup(Cexprtab *cexpr, const char *s);
+
 /* puts the union of the two sets in l1 */
 static inline void merge_sets(int *l1, int *l2, int size)
 {
 	do_merge_sets(l1, l1, l2, size);
 }
+
+/* builds the transitions of state i of a lazy alternating automaton, if not
+ * done yet, and returns them */
+ATrans *lazy_atrans(const Alternating *alt, int i);
+void lazy_stats(FILE *f, const Alternating *alt);
+
+/* returns the transitions of state i of the alternating automaton */
+static inline ATrans *get_atrans(const Alternating *alt, int i)
+{
+	return alt->lazy ? lazy_atrans(alt, i) : alt->transition[i];
+}
+
+/* a transition of a state, by the address of its target and its position in
+ * the list of the state: sorted by cmp_trans_ref(), the transitions are
+ * grouped by target and keep their order within a group */
+struct trans_ref {
+	uintptr_t to;
+	int i;
+};
+
+static inline int cmp_trans_ref(const void *a, const void *b)
+{
+	const struct trans_ref *x = a, *y = b;
+	if (x->to != y->to)
+		return x->to < y->to ? -1 : 1;
+	return x->i - y->i;
+}
@@ -21,17 +21,74 @@ isalnum_(int c)
 {       return (isalnum(c) || c == '_');
 }
 
-static int hash(const char *s)
-{
-	int h=0;
-
-        while (*s)
-        {       h += *s++;
-                h <<= 1;
-                if (h&(LTL2BA_Nhash+1))
-                        h |= 1;
-        }
-        return h&LTL2BA_Nhash;
+static unsigned hash(const char *s)
+{	/* 32-bit FNV-1a */
+	unsigned h = 2166136261u;
+
+	while (*s)
+	{	h ^= (unsigned char) *s++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static int
+cexpr_probe(const Cexprtab *cexpr, const char *s)
+{	int mask = cexpr->cexpr_size - 1;
+	int i = hash(s) & mask;
+
+	while (cexpr->cexpr_slots[i]
+	&&     strcmp(cexpr->cexpr_expr_table[cexpr->cexpr_slots[i] - 1], s) != 0)
+		i = (i + 1) & mask;
+	return i;
+}
+
+static void
+cexpr_grow(Cexprtab *cexpr)
+{	char **old_table = cexpr->cexpr_expr_table;
+	int *old_slots = cexpr->cexpr_slots;
+	int i, n = cexpr->cexpr_size;
+
+	cexpr->cexpr_size = n ? 2 * n : 64;
+	cexpr->cexpr_slots = tl_emalloc(cexpr->cexpr_size * sizeof(int));
+	cexpr->cexpr_expr_table = tl_emalloc(cexpr->cexpr_size / 2 * sizeof(char *));
+	for (i = 0; i < cexpr->cexpr_idx; i++)
+	{	cexpr->cexpr_expr_table[i] = old_table[i];
+		cexpr->cexpr_slots[cexpr_probe(cexpr, old_table[i])] = i + 1;
+	}
+	if (old_table)
+	{	tfree(old_table);
+		tfree(old_slots);
+	}
+}
+
+/* returns the index of C expression s, adding it if it is new */
+int
+cexpr_lookup(Cexprtab *cexpr, const char *s)
+{	int i;
+
+	if (2 * (cexpr->cexpr_idx + 1) > cexpr->cexpr_size)
+		cexpr_grow(cexpr); /* keep the load factor at most 1/2 */
+
+	i = cexpr_probe(cexpr, s);
+	if (!cexpr->cexpr_slots[i])
+	{	cexpr->cexpr_expr_table[cexpr->cexpr_idx] = strdup(s);
+		cexpr->cexpr_slots[i] = ++cexpr->cexpr_idx;
+	}
+	return cexpr->cexpr_slots[i] - 1;
+}
+
+void
+free_cexprtab(Cexprtab *cexpr)
+{	int i;
+
+	for (i = 0; i < cexpr->cexpr_idx; i++)
+		free(cexpr->cexpr_expr_table[i]);
+	if (cexpr->cexpr_size)
+	{	tfree(cexpr->cexpr_expr_table);
+		tfree(cexpr->cexpr_slots);
+	}
+	memset(cexpr, 0, sizeof(*cexpr));
 }
 
 static void
@@ -92,21 +149,8 @@ tl_lex(Symtab symtab, Cexprtab *cexpr, Lexer *lex)
 		} while (1);
 
 		lex->yytext[idx++] = '\0';
-		cexpr->cexpr_expr_table[cexpr->cexpr_idx] = (char *)strdup(lex->yytext);
-
-		for (idx = 0; idx < cexpr->cexpr_idx; idx++) {
-			if (!strcmp(cexpr->cexpr_expr_table[cexpr->cexpr_idx],
-			            cexpr->cexpr_expr_table[idx])) {
-				sprintf(buffer, "_ltl2ba_cexpr_%d_status",idx);
-				break;
-			}
-		}
-
-		if (idx == cexpr->cexpr_idx)
-			sprintf(buffer, "_ltl2ba_cexpr_%d_status", cexpr->cexpr_idx++);
-
-		if (cexpr->cexpr_idx == 256)
-			tl_yyerror(lex, "You have too many C expressions");
+		sprintf(buffer, "_ltl2ba_cexpr_%d_status",
+		        cexpr_lookup(cexpr, lex->yytext));
 
 		lex->tl_yylval = tl_nn(PREDICATE,NULL,NULL);
 		lex->tl_yylval->sym = tl_lookup(symtab, buffer);
@@ -183,20 +227,52 @@ tl_yylex(Symtab symtab, Cexprtab *cexpr, Lexer *lex)
 	return c;
 }
 
+static int
+symtab_probe(Symtab symtab, const char *s)
+{	int mask = symtab->size - 1;
+	int i = hash(s) & mask;
+
+	while (symtab->slots[i] && strcmp(symtab->slots[i]->name, s) != 0)
+		i = (i + 1) & mask;
+	return i;
+}
+
+static void
+symtab_grow(Symtab symtab)
+{	Symbol **old = symtab->slots;
+	int i, n = symtab->size;
+
+	symtab->size = n ? 2 * n : 64;
+	symtab->slots = tl_emalloc(symtab->size * sizeof(Symbol *));
+	for (i = 0; i < n; i++)
+		if (old[i])
+			symtab->slots[symtab_probe(symtab, old[i]->name)] = old[i];
+	if (old)
+		tfree(old);
+}
+
 Symbol * tl_lookup(Symtab symtab, const char *s)
 {
 	Symbol *sp;
-	int h = hash(s);
+	int i;
+
+	if (!symtab->size)
+		symtab_grow(symtab);
 
-	for (sp = symtab[h]; sp; sp = sp->next)
-		if (strcmp(sp->name, s) == 0)
-			return sp;
+	i = symtab_probe(symtab, s);
+	if (symtab->slots[i])
+		return symtab->slots[i];
+
+	if (2 * (symtab->count + 1) > symtab->size)
+	{	symtab_grow(symtab); /* keep the load factor at most 1/2 */
+		i = symtab_probe(symtab, s);
+	}
 
 	sp = tl_emalloc(sizeof(Symbol));
 	sp->name = tl_emalloc(strlen(s) + 1);
 	strcpy(sp->name, s);
-	sp->next = symtab[h];
-	symtab[h] = sp;
+	sp->id = symtab->count++;
+	symtab->slots[i] = sp;
 
 	return sp;
 }
@@ -1,5 +1,7 @@
 
-#include <ltl2ba.h>
+#include "internal.h"
+
+#include <pthread.h>
 
 #define STR(x)	#x
 #define XSTR(x)	STR(x)
@@ -10,3 +12,106 @@ const char * ltl2ba_version(void)
                                 XSTR(LTL2BA_VERSION_MINOR);
   return version;
 }
+
+static int threads = 1;
+
+void ltl2ba_set_threads(int n)
+{
+  threads = n < 1 ? 1 : n;
+}
+
+int ltl2ba_threads(void)
+{
+  return threads;
+}
+
+/* the threads helping the calling thread, kept for its next automata */
+struct helpers {
+  pthread_mutex_t lock;
+  pthread_cond_t wake, done;
+  void (*fn)(void *);
+  void *arg;
+  unsigned gen;         /* number of jobs started */
+  int n, busy;
+};
+
+struct helper_arg {
+  struct helpers *h;
+  unsigned gen;         /* the last job the thread took part in */
+};
+
+static TL_THREAD_LOCAL struct helpers *helpers;
+
+static void *helper_main(void *arg)
+{
+  struct helper_arg *a = arg;
+  struct helpers *h = a->h;
+
+  pthread_mutex_lock(&h->lock);
+  for(;;) {
+    while(h->gen == a->gen)
+      pthread_cond_wait(&h->wake, &h->lock);
+    a->gen = h->gen;
+    void (*fn)(void *) = h->fn;
+    void *fn_arg = h->arg;
+    pthread_mutex_unlock(&h->lock);
+    fn(fn_arg);
+    free_all_atrans(); /* the pooled sets have this automaton's sizes */
+    pthread_mutex_lock(&h->lock);
+    if(!--h->busy)
+      pthread_cond_signal(&h->done);
+  }
+  return NULL;
+}
+
+void run_in_threads(void (*fn)(void *), void *arg, int n)
+{
+  struct helpers *h = helpers;
+
+  if(!h) {
+    if(!(h = helpers = calloc(1, sizeof(*h))))
+      fatal("not enough memory");
+    pthread_mutex_init(&h->lock, NULL);
+    pthread_cond_init(&h->wake, NULL);
+    pthread_cond_init(&h->done, NULL);
+  }
+  pthread_mutex_lock(&h->lock);
+  while(h->n < n - 1) {
+    struct helper_arg *a = malloc(sizeof(*a));
+    pthread_t tid;
+    if(!a) break;
+    a->h = h;
+    a->gen = h->gen;
+    if(pthread_create(&tid, NULL, helper_main, a)) {
+      free(a);
+      break; /* the threads there are will do */
+    }
+    pthread_detach(tid);
+    h->n++;
+  }
+  h->fn = fn;
+  h->arg = arg;
+  h->gen++;
+  h->busy = h->n;
+  pthread_cond_broadcast(&h->wake);
+  pthread_mutex_unlock(&h->lock);
+
+  fn(arg);
+
+  pthread_mutex_lock(&h->lock);
+  while(h->busy)
+    pthread_cond_wait(&h->done, &h->lock);
+  pthread_mutex_unlock(&h->lock);
+}
+
+static int simp_budget;
+
+void ltl2ba_set_simp_budget(int ms)
+{
+  simp_budget = ms < 0 ? 0 : ms;
+}
+
+int ltl2ba_simp_budget(void)
+{
+  return simp_budget;
+}
@@ -11,12 +11,25 @@
 
 #include <unistd.h>
 #include <libgen.h>	/* basename() */
+#include <getopt.h>	/* getopt_long() */
+#include <setjmp.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include "internal.h"
 
-static int	tl_errs      = 0;
+static TL_THREAD_LOCAL int	tl_errs      = 0;
 
-static char	uform[4096];
-static int	hasuform=0, cnt=0;
+static TL_THREAD_LOCAL char	*uform;
+static TL_THREAD_LOCAL int	hasuform=0, cnt=0, uform_sz=0;
+
+static TL_THREAD_LOCAL jmp_buf	*tl_recover; /* set in batch mode: errors abort only the formula */
+static TL_THREAD_LOCAL FILE	*tl_err;     /* diagnostics, stderr if NULL */
 
 enum out {
 	OUT_SPIN,
@@ -31,6 +44,8 @@ static void	tl_endstats(void);
 static void
 alldone(int estatus)
 {
+	if (tl_recover)
+		longjmp(*tl_recover, 1);
 	exit(estatus);
 }
 
@@ -56,7 +71,8 @@ tl_Getchar(void)
 
 void put_uform(FILE *f)
 {
-	fprintf(f, "%s", uform);
+	if (uform)
+		fprintf(f, "%s", uform);
 }
 
 void
@@ -72,8 +88,23 @@ usage(int code)
 	fprintf(f, "\
 usage: %s [-flag] -f 'formula'\n\
        %*s      or -F file\n\
+       %*s      or -B file\n\
+       %*s      or --serve[=socket]\n\
  -f 'formula'  translate LTL formula into never claim\n\
  -F file       like -f, but with the LTL formula stored in a 1-line file\n\
+ -B file       (B)atch mode: translate each line of file ('-' for stdin) in\n\
+               turn, each result is followed by a line '/* end of formula N */'\n\
+ -0            with -B, formulas and results are separated by NUL characters\n\
+ -j N          with -B, translate in N threads (0: one per processor); the\n\
+               output stays in input order, -s reports only per formula\n\
+ -t N          expand the states of the generalized automaton in N (T)hreads\n\
+               (0: one per processor); the automata stay the same\n\
+ -b MS         stop simplifying each automaton after about MS milliseconds\n\
+               and output it as it is then\n\
+ --serve[=socket]\n\
+               serve requests '[-acopliLmr] [-O mode] formula', one per line, read\n\
+               from stdin or from clients of the UNIX socket; each is answered\n\
+               by a line 'ok N' or 'error N' and N bytes of automaton or error\n\
  -P            Specify ltl2c symbol prefixes\n\
  -i            Invert formula once read\n\
  -d            display automata (D)escription at each step\n\
@@ -83,77 +114,594 @@ usage: %s [-flag] -f 'formula'\n\
  -o            disable (O)n-the-fly simplification\n\
  -c            disable strongly (C)onnected components simplification\n\
  -a            disable trick in (A)ccepting conditions\n\
+ -L            build the alternating automaton's states (L)azily, when reached\n\
+ -m            (M)inimize the Buchi automaton up to bisimulation instead of\n\
+               merging only the states with the same transitions\n\
+ -r            (R)educe the Buchi automaton by direct simulation: drop the\n\
+               transitions to simulated states and merge equivalent ones\n\
  -O mode       output mode; one of spin, c or dot\n\
  -C            dump cache info at the end\n\
  -H C_HEADER   optional #include identifier of a header with extern symbol\n\
                declarations for C output, either in \"quotes\" or in <brackets>\n\
-", progname, (int)strlen(progname), "");
+", progname, (int)strlen(progname), "", (int)strlen(progname), "",
+	        (int)strlen(progname), "");
 	alldone(code);
 }
 
 static char *cmdline;
 
-static void tl_main(char *formula, enum out outmode, Flags flags,
-                    const char *c_sym_name_prefix, const char *extern_c_header)
+/* options of a translation, shared by all formulas of a run */
+struct tl_opts {
+	enum out outmode;
+	Flags flags;
+	const char *c_sym_name_prefix;
+	const char *extern_c_header;
+	int invert_formula;
+	int sep; /* record separator in batch mode */
+};
+
+static void tl_main(char *formula, FILE *out, FILE *err,
+                    const struct tl_opts *o, Symtab symtab, int nr)
 {
+	struct timespec t_debut, t_fin;
+	int bstate_count = 0, btrans_count = 0;
+	Flags flags = o->flags;
+
+	if (flags & LTL2BA_STATS)
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t_debut);
+
+	tl_err = err;
+
 	for (int i = 0; formula[i]; i++)
 		if (formula[i] == '\t'
 		||  formula[i] == '\"'
 		||  formula[i] == '\n')
 			formula[i] = ' ';
 
+	hasuform = strlen(formula);
+	if (hasuform >= uform_sz) {
+		uform_sz = hasuform + 1;
+		uform = realloc(uform, uform_sz);
+		if (!uform)
+			fatal("not enough memory to store the formula");
+	}
 	strcpy(uform, formula);
-	hasuform = strlen(uform);
+	cnt = 0;
 
-	Symtab symtab;
-	memset(&symtab, 0, sizeof(symtab));
 	Cexprtab cexpr;
 	memset(&cexpr, 0, sizeof(cexpr));
 
 	Node *p = tl_parse(symtab, &cexpr, flags);
 	if (flags & LTL2BA_VERBOSE)
 	{
-		fprintf(stderr, "formula: ");
-		put_uform(stderr);
-		fprintf(stderr, "\n");
+		fprintf(err, "formula: ");
+		put_uform(err);
+		fprintf(err, "\n");
 	}
 
-	if (!p || tl_errs)
+	if (!p || tl_errs) {
+		free_cexprtab(&cexpr);
 		return;
+	}
 
 	if (flags & LTL2BA_VERBOSE) {
-		fprintf(stderr, "\t/* Normlzd: ");
-		dump(stderr, p);
-		fprintf(stderr, " */\n");
+		fprintf(err, "\t/* Normlzd: ");
+		dump(err, p);
+		fprintf(err, " */\n");
 	}
 
-	Alternating alt = mk_alternating(p, stderr, &cexpr, flags);
-	releasenode(1, p);
+	Alternating alt = mk_alternating(p, err, &cexpr, flags);
+	if (!alt.lazy) /* else mk_generalized() builds states from p */
+		releasenode(1, p);
 
-	Generalized gen = mk_generalized(&alt, stderr, flags, &cexpr);
-	// free the data from the alternating automaton
-	/* for(i = 0; i < alt->node_id; i++)
-		free_atrans(transition[i], 1); */
-	free_all_atrans();
-	tfree(alt.transition);
+	Generalized gen = mk_generalized(&alt, err, flags, &cexpr);
+	if (alt.lazy)
+		releasenode(1, p);
+	free_alternating(&alt);
 
-	Buchi b = mk_buchi(&gen, stderr, flags, alt.sym_table, &cexpr);
+	Buchi b = mk_buchi(&gen, err, flags, alt.sym_table, &cexpr);
+
+	if (nr && (flags & LTL2BA_STATS)) /* the printers modify b */
+		for (BState *s = b.bstates->nxt; s != b.bstates; s = s->nxt) {
+			bstate_count++;
+			for (BTrans *t = s->trans->nxt; t != s->trans; t = t->nxt)
+				btrans_count++;
+		}
 
-	switch (outmode) {
+	switch (o->outmode) {
 	case OUT_SPIN:
-		print_spin_buchi(stdout, &b, alt.sym_table);
+		print_spin_buchi(out, &b, alt.sym_table);
 		break;
 	case OUT_C:
-		print_c_buchi(stdout, &b, alt.sym_table, &cexpr, alt.sym_id,
-		              c_sym_name_prefix, extern_c_header, cmdline);
+		print_c_buchi(out, &b, alt.sym_table, &cexpr, alt.sym_id,
+		              o->c_sym_name_prefix, o->extern_c_header, cmdline);
 		break;
 	case OUT_DOT:
-		print_dot_buchi(stdout, &b, alt.sym_table, &cexpr);
+		print_dot_buchi(out, &b, alt.sym_table, &cexpr);
 		break;
 	}
 
-	if (flags & LTL2BA_STATS)
+	free_buchi(&b);
+	free_generalized(&gen);
+	if (alt.sym_table)
+		tfree(alt.sym_table);
+	free_cexprtab(&cexpr);
+
+	if (!(flags & LTL2BA_STATS))
+		return;
+	if (!nr) {
 		tl_endstats();
+		return;
+	}
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t_fin);
+	if (t_fin.tv_nsec < t_debut.tv_nsec) {
+		t_fin.tv_nsec += 1000000000;
+		t_fin.tv_sec--;
+	}
+	fprintf(err, "\nformula %d: %ld.%06lis, %i states, %i transitions\n",
+	        nr, (long)(t_fin.tv_sec - t_debut.tv_sec),
+	        (t_fin.tv_nsec - t_debut.tv_nsec) / 1000,
+	        bstate_count, btrans_count);
+}
+
+/* translates a formula of a batch, errors only abort this formula;
+ * returns whether it failed */
+static int batch_one(char *formula, FILE *out, FILE *err,
+                     const struct tl_opts *o, Symtab symtab, int nr)
+{
+	jmp_buf recover;
+
+	tl_errs = 0;
+	if (!setjmp(recover)) {
+		tl_recover = &recover;
+		tl_main(formula, out, err, o, symtab, nr);
+	}
+	tl_recover = NULL;
+	tl_err = NULL;
+	return tl_errs != 0;
+}
+
+static void end_of_formula(FILE *out, const struct tl_opts *o, int nr)
+{
+	if (o->sep == '\n')
+		fprintf(out, "/* end of formula %d */\n", nr);
+	else
+		putc(o->sep, out);
+}
+
+/* returns the next non-blank record of 'in' as a malloc()ed string or NULL at
+ * the end of the input */
+static char *read_formula(FILE *in, const struct tl_opts *o)
+{
+	char *line = NULL;
+	size_t line_sz = 0;
+	ssize_t len;
+
+	while ((len = getdelim(&line, &line_sz, o->sep, in)) != -1) {
+		if (len && line[len-1] == o->sep)
+			line[--len] = '\0';
+		if (!line[strspn(line, " \t\r\n")])
+			continue; /* skip blank lines */
+		if (!o->invert_formula)
+			return line;
+		char *inv_formula = malloc(len + 4);
+		if (!inv_formula)
+			fatal("not enough memory to invert formula");
+		sprintf(inv_formula, "!(%s)", line);
+		free(line);
+		return inv_formula;
+	}
+	free(line);
+	return NULL;
+}
+
+/* translates each formula read from 'in', returns the number of failures */
+static int batch(FILE *in, const struct tl_opts *o)
+{
+	Symtab symtab; /* shared by all formulas */
+	int nr = 0, failed = 0;
+
+	memset(&symtab, 0, sizeof(symtab));
+
+	for (char *formula; (formula = read_formula(in, o));) {
+		failed += batch_one(formula, stdout, stderr, o, symtab, ++nr);
+		free(formula);
+		end_of_formula(stdout, o, nr);
+		fflush(stdout);
+	}
+
+	if (o->flags & LTL2BA_STATS)
+		tl_endstats();
+
+	return failed;
+}
+
+struct job {
+	char *formula;
+	char *out, *err;          /* output and diagnostics, see open_memstream() */
+	size_t out_sz, err_sz;
+	int failed;
+	int errnum;               /* why the buffers could not be opened, or 0 */
+	int done;                 /* protected by pool.lock */
+};
+
+/* jobs are dealt round-robin to the workers as they are read; a worker takes
+ * its own jobs from the front, i.e. in input order, and steals from the back
+ * of the other queues once its own is empty. The queues are protected by
+ * pool.lock */
+struct queue {
+	int *jobs;
+	int head, tail, size;
+};
+
+struct pool {
+	const struct tl_opts *o;
+	FILE *in;
+	struct job **jobs;        /* protected by lock, as are n_jobs and eof */
+	int n_jobs, eof;
+	struct queue *queues;
+	int n_workers;
+	pthread_mutex_t lock;
+	pthread_cond_t more;      /* signalled whenever a job is read */
+	pthread_cond_t done;      /* signalled whenever a job is done */
+};
+
+struct worker {
+	struct pool *pool;
+	int id;
+};
+
+/* returns the next job of worker 'id', -1 if there is none yet; called with
+ * pool.lock held */
+static int next_job(struct pool *p, int id)
+{
+	struct queue *q = &p->queues[id];
+	int j = -1;
+
+	if (q->head < q->tail)
+		j = q->jobs[q->head++];
+
+	for (int i = 1; j < 0 && i < p->n_workers; i++) {
+		q = &p->queues[(id + i) % p->n_workers];
+		if (q->head < q->tail)
+			j = q->jobs[--q->tail];
+	}
+	return j;
+}
+
+static void *worker_main(void *arg)
+{
+	struct worker *w = arg;
+	struct pool *p = w->pool;
+	Symtab symtab; /* shared by all formulas of this thread, as is the cache */
+
+	memset(&symtab, 0, sizeof(symtab));
+
+	for (;;) {
+		struct job *job;
+		int j;
+
+		pthread_mutex_lock(&p->lock);
+		while ((j = next_job(p, w->id)) < 0 && !p->eof)
+			pthread_cond_wait(&p->more, &p->lock);
+		job = j < 0 ? NULL : p->jobs[j];
+		pthread_mutex_unlock(&p->lock);
+		if (!job)
+			break;
+
+		FILE *out = open_memstream(&job->out, &job->out_sz);
+		FILE *err = open_memstream(&job->err, &job->err_sz);
+		if (out && err) {
+			job->failed = batch_one(job->formula, out, err, p->o,
+			                        symtab, j + 1);
+			end_of_formula(out, p->o, j + 1);
+		} else {
+			job->errnum = errno ? errno : ENOMEM;
+			job->failed = 1;
+		}
+		if (out)
+			fclose(out);
+		if (err)
+			fclose(err);
+
+		pthread_mutex_lock(&p->lock);
+		job->done = 1;
+		pthread_cond_broadcast(&p->done);
+		pthread_mutex_unlock(&p->lock);
+	}
+
+	free(uform);
+	return NULL;
+}
+
+/* reads the formulas and deals them to the workers */
+static void *reader_main(void *arg)
+{
+	struct pool *p = arg;
+
+	for (char *formula; (formula = read_formula(p->in, p->o));) {
+		struct job *job = calloc(1, sizeof(*job));
+		if (!job)
+			fatal("not enough memory to read the formulas");
+		job->formula = formula;
+
+		pthread_mutex_lock(&p->lock);
+		int j = p->n_jobs;
+		if (!(j & (j - 1)))
+			p->jobs = realloc(p->jobs, (j ? 2 * j : 1) * sizeof(*p->jobs));
+		if (!p->jobs)
+			fatal("not enough memory to read the formulas");
+		p->jobs[j] = job;
+
+		struct queue *q = &p->queues[j % p->n_workers];
+		if (q->tail == q->size) {
+			q->size = q->size ? 2 * q->size : 16;
+			q->jobs = realloc(q->jobs, q->size * sizeof(*q->jobs));
+			if (!q->jobs)
+				fatal("not enough memory to read the formulas");
+		}
+		q->jobs[q->tail++] = j;
+
+		p->n_jobs++;
+		pthread_cond_broadcast(&p->more);
+		pthread_mutex_unlock(&p->lock);
+	}
+
+	pthread_mutex_lock(&p->lock);
+	p->eof = 1;
+	pthread_cond_broadcast(&p->more);
+	pthread_mutex_unlock(&p->lock);
+	return NULL;
+}
+
+/* like batch(), but translates the formulas in 'n_workers' threads while they
+ * are read; the results are written in input order as soon as they are done */
+static int batch_parallel(FILE *in, const struct tl_opts *o, int n_workers)
+{
+	struct pool p = { .o = o, .in = in, .n_workers = n_workers };
+	struct worker *workers = calloc(n_workers, sizeof(*workers));
+	pthread_t *threads = calloc(n_workers, sizeof(*threads)), reader;
+	int failed = 0;
+
+	p.queues = calloc(n_workers, sizeof(*p.queues));
+	if (!workers || !threads || !p.queues)
+		fatal("not enough memory to start the worker threads");
+	pthread_mutex_init(&p.lock, NULL);
+	pthread_cond_init(&p.more, NULL);
+	pthread_cond_init(&p.done, NULL);
+
+	for (int i = 0; i < n_workers; i++) {
+		workers[i].pool = &p;
+		workers[i].id = i;
+		if (pthread_create(&threads[i], NULL, worker_main, &workers[i]))
+			fatal("cannot start worker thread");
+	}
+	if (pthread_create(&reader, NULL, reader_main, &p))
+		fatal("cannot start reader thread");
+
+	pthread_mutex_lock(&p.lock);
+	for (int j = 0;; j++) {
+		while (j == p.n_jobs && !p.eof)
+			pthread_cond_wait(&p.more, &p.lock);
+		if (j == p.n_jobs)
+			break;
+		struct job *job = p.jobs[j];
+		while (!job->done)
+			pthread_cond_wait(&p.done, &p.lock);
+		p.jobs[j] = NULL;
+		pthread_mutex_unlock(&p.lock);
+
+		if (job->errnum) {
+			fprintf(stderr, "%s: formula %d: %s\n", progname, j + 1,
+			        strerror(job->errnum));
+			end_of_formula(stdout, o, j + 1);
+		}
+		fwrite(job->err, 1, job->err_sz, stderr);
+		fwrite(job->out, 1, job->out_sz, stdout);
+		fflush(stdout);
+		failed += job->failed;
+		free(job->formula);
+		free(job->out);
+		free(job->err);
+		free(job);
+
+		pthread_mutex_lock(&p.lock);
+	}
+	pthread_mutex_unlock(&p.lock);
+
+	pthread_join(reader, NULL);
+	for (int i = 0; i < n_workers; i++)
+		pthread_join(threads[i], NULL);
+	for (int i = 0; i < n_workers; i++)
+		free(p.queues[i].jobs);
+	pthread_cond_destroy(&p.done);
+	pthread_cond_destroy(&p.more);
+	pthread_mutex_destroy(&p.lock);
+	free(p.queues);
+	free(threads);
+	free(workers);
+	free(p.jobs);
+
+	return failed;
+}
+
+/* Server mode. Every request is a line of options followed by the formula,
+ *
+ *   [-acopliLmr] [-O spin|c|dot] formula
+ *
+ * where the options have the same meaning as on the command line and are
+ * applied on top of those the server was started with. Each request is
+ * answered by a header line 'ok N' or 'error N' followed by exactly N bytes:
+ * the automaton, or the diagnostics. The symbol table, the rewrite cache and
+ * the memory pools are shared by all requests. */
+
+/* parses the options of a request into 'o', returns the formula or NULL */
+static char *parse_request(char *line, struct tl_opts *o, FILE *err)
+{
+	char *p = line;
+
+	for (;;) {
+		p += strspn(p, " \t");
+		if (p[0] != '-' || p[1] == '>')
+			return p;
+		size_t n = strcspn(p, " \t");
+		char *opt = p + 1, *end = p + n;
+		for (p = end; opt < end; opt++)
+			switch (*opt) {
+			case 'a': o->flags &= ~LTL2BA_FJTOFJ; break;
+			case 'c': o->flags &= ~LTL2BA_SIMP_SCC; break;
+			case 'o': o->flags &= ~LTL2BA_SIMP_FLY; break;
+			case 'p': o->flags &= ~LTL2BA_SIMP_DIFF; break;
+			case 'l': o->flags &= ~LTL2BA_SIMP_LOG; break;
+			case 'L': o->flags |= LTL2BA_LAZY; break;
+			case 'm': o->flags |= LTL2BA_SIMP_BISIM; break;
+			case 'r': o->flags |= LTL2BA_SIMP_SIM; break;
+			case 'i': o->invert_formula = 1; break;
+			case 'O': {
+				char *mode = opt + 1;
+				if (mode == end) {
+					mode = p + strspn(p, " \t");
+					end = mode + strcspn(mode, " \t");
+					p = end;
+				}
+				if (end - mode == 4 && !strncmp(mode, "spin", 4))
+					o->outmode = OUT_SPIN;
+				else if (end - mode == 1 && !strncmp(mode, "c", 1))
+					o->outmode = OUT_C;
+				else if (end - mode == 3 && !strncmp(mode, "dot", 3))
+					o->outmode = OUT_DOT;
+				else {
+					fprintf(err, "%s: unknown output mode '%.*s'\n",
+					        progname, (int)(end - mode), mode);
+					return NULL;
+				}
+				opt = end - 1;
+				break;
+			}
+			default:
+				fprintf(err, "%s: unknown option '-%c'\n", progname, *opt);
+				return NULL;
+			}
+	}
+}
+
+/* answers the requests read from 'in' on 'out' until the end of the input */
+static void serve(FILE *in, FILE *out, const struct tl_opts *defaults,
+                  Symtab symtab, int *nr)
+{
+	char *line = NULL, *res = NULL, *msg = NULL, *inv_formula = NULL;
+	size_t line_sz = 0, res_sz, msg_sz;
+	ssize_t len;
+
+	while ((len = getline(&line, &line_sz, in)) != -1) {
+		struct tl_opts o = *defaults;
+		int failed = 1;
+
+		while (len && (line[len-1] == '\n' || line[len-1] == '\r'))
+			line[--len] = '\0';
+
+		FILE *r = open_memstream(&res, &res_sz);
+		FILE *m = open_memstream(&msg, &msg_sz);
+		if (!r || !m) {
+			const char *e = strerror(errno ? errno : ENOMEM);
+			if (r) {
+				fclose(r);
+				free(res);
+			}
+			if (m) {
+				fclose(m);
+				free(msg);
+			}
+			fprintf(out, "error %d\n%s: %s\n",
+			        snprintf(NULL, 0, "%s: %s\n", progname, e), progname, e);
+			if (fflush(out) == EOF)
+				break;
+			continue;
+		}
+		char *formula = parse_request(line, &o, m);
+		if (formula && o.invert_formula) {
+			inv_formula = realloc(inv_formula, strlen(formula) + 4);
+			if (!inv_formula)
+				fatal("not enough memory to invert formula");
+			sprintf(inv_formula, "!(%s)", formula);
+			formula = inv_formula;
+		}
+		if (formula)
+			failed = batch_one(formula, r, m, &o, symtab, ++*nr);
+		fclose(r);
+		fclose(m);
+
+		if (failed) {
+			fprintf(out, "error %zu\n", msg_sz);
+			fwrite(msg, 1, msg_sz, out);
+		} else {
+			fwrite(msg, 1, msg_sz, stderr); /* -d and -s */
+			fprintf(out, "ok %zu\n", res_sz);
+			fwrite(res, 1, res_sz, out);
+		}
+		free(res);
+		free(msg);
+		if (fflush(out) == EOF)
+			break; /* the client is gone */
+	}
+
+	free(line);
+	free(inv_formula);
+}
+
+/* serves the clients connecting to the UNIX socket 'path' one at a time */
+static int serve_socket(const char *path, const struct tl_opts *o,
+                        Symtab symtab, int *nr)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	int fd;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "%s: socket path too long: %s\n", progname, path);
+		return 1;
+	}
+	strcpy(addr.sun_path, path);
+
+	/* the socket of a server that was killed is left behind: it is
+	 * replaced, unless a server still accepts connections on it */
+	struct stat st;
+	if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)
+	&&  (fd = socket(AF_UNIX, SOCK_STREAM, 0)) != -1) {
+		if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1
+		&&  errno == ECONNREFUSED)
+			unlink(path);
+		close(fd);
+	}
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1
+	||  bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1
+	||  listen(fd, 8) == -1) {
+		fprintf(stderr, "%s: cannot listen on %s: %s\n", progname, path,
+		        strerror(errno));
+		return 1;
+	}
+	signal(SIGPIPE, SIG_IGN);
+
+	for (;;) {
+		int c = accept(fd, NULL, NULL);
+		if (c == -1) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			fprintf(stderr, "%s: accept: %s\n", progname, strerror(errno));
+			break;
+		}
+		int d = dup(c);
+		FILE *in = fdopen(c, "r");
+		FILE *out = d == -1 ? NULL : fdopen(d, "w");
+		if (in && out)
+			serve(in, out, o, symtab, nr);
+		if (in) fclose(in); else close(c);
+		if (out) fclose(out); else if (d != -1) close(d);
+	}
+
+	close(fd);
+	unlink(path);
+	return 1;
 }
 
 static void free_cmdline(void)
@@ -164,19 +712,24 @@ static void free_cmdline(void)
 int main(int argc, char *argv[])
 {
 	int i;
-	int invert_formula = 0;
 	char *ltl_file = NULL;
 	char *add_ltl  = NULL;
+	char *batch_file = NULL;
+	char *serve_path = NULL;
+	int server = 0;
 	char *formula  = NULL, *inv_formula = NULL;
-	Flags flags    = LTL2BA_SIMP_LOG
-	               | LTL2BA_SIMP_DIFF
-	               | LTL2BA_SIMP_FLY
-	               | LTL2BA_SIMP_SCC
-	               | LTL2BA_FJTOFJ;
-	enum out outmode = OUT_SPIN;
-	const char *c_sym_name_prefix = "_ltl2ba";
-	const char *extern_c_header = NULL;
+	struct tl_opts o = {
+		.outmode = OUT_SPIN,
+		.flags   = LTL2BA_SIMP_LOG
+		         | LTL2BA_SIMP_DIFF
+		         | LTL2BA_SIMP_FLY
+		         | LTL2BA_SIMP_SCC
+		         | LTL2BA_FJTOFJ,
+		.c_sym_name_prefix = "_ltl2ba",
+		.sep     = '\n',
+	};
 	int display_cache = 0;
+	int n_workers = 1;
 
 	atexit(free_cmdline);
 
@@ -195,40 +748,112 @@ int main(int argc, char *argv[])
 
 	progname = argv[0] ? basename(argv[0]) : "";
 	if (!strcmp(progname, "ltl2c"))
-		outmode = OUT_C;
-
-	for (int opt; (opt = getopt(argc, argv, ":hF:f:acopldsO:PiCH:")) != -1;)
+		o.outmode = OUT_C;
+
+	static const struct option long_opts[] = {
+		{ "serve", optional_argument, NULL, 'S' },
+		{ NULL, 0, NULL, 0 },
+	};
+	for (int opt; (opt = getopt_long(argc, argv, ":hF:f:B:0j:t:b:acopldLmrsO:PiCH:",
+	                                 long_opts, NULL)) != -1;)
 		switch (opt) {
+		case 'S': server = 1; serve_path = optarg; break;
 		case 'h': usage(0); break;
 		case 'F': ltl_file = optarg; break;
 		case 'f': add_ltl = optarg; break;
-		case 'a': flags &= ~LTL2BA_FJTOFJ; break;
-		case 'c': flags &= ~LTL2BA_SIMP_SCC; break;
-		case 'o': flags &= ~LTL2BA_SIMP_FLY; break;
-		case 'p': flags &= ~LTL2BA_SIMP_DIFF; break;
-		case 'l': flags &= ~LTL2BA_SIMP_LOG; break;
-		case 'd': flags |= LTL2BA_VERBOSE; break;
-		case 's': flags |= LTL2BA_STATS; break;
+		case 'B': batch_file = optarg; break;
+		case '0': o.sep = '\0'; break;
+		case 'j':
+			n_workers = atoi(optarg);
+			if (n_workers < 0)
+				usage(1);
+			if (!n_workers)
+				n_workers = sysconf(_SC_NPROCESSORS_ONLN);
+			break;
+		case 't': {
+			int n = atoi(optarg);
+			if (n < 0)
+				usage(1);
+			ltl2ba_set_threads(n ? n : sysconf(_SC_NPROCESSORS_ONLN));
+			break;
+		}
+		case 'b': {
+			char *end;
+			long ms = strtol(optarg, &end, 10);
+			if (end == optarg || *end || ms < 0 || ms > INT_MAX)
+				usage(1);
+			ltl2ba_set_simp_budget(ms);
+			break;
+		}
+		case 'a': o.flags &= ~LTL2BA_FJTOFJ; break;
+		case 'c': o.flags &= ~LTL2BA_SIMP_SCC; break;
+		case 'o': o.flags &= ~LTL2BA_SIMP_FLY; break;
+		case 'p': o.flags &= ~LTL2BA_SIMP_DIFF; break;
+		case 'l': o.flags &= ~LTL2BA_SIMP_LOG; break;
+		case 'd': o.flags |= LTL2BA_VERBOSE; break;
+		case 'L': o.flags |= LTL2BA_LAZY; break;
+		case 'm': o.flags |= LTL2BA_SIMP_BISIM; break;
+		case 'r': o.flags |= LTL2BA_SIMP_SIM; break;
+		case 's': o.flags |= LTL2BA_STATS; break;
 		case 'O':
 			if (strcmp("spin", optarg) == 0)
-				outmode = OUT_SPIN;
+				o.outmode = OUT_SPIN;
 			else if (strcmp("c", optarg) == 0)
-				outmode = OUT_C;
+				o.outmode = OUT_C;
 			else if (strcmp("dot", optarg) == 0)
-				outmode = OUT_DOT;
+				o.outmode = OUT_DOT;
 			else
 				usage(1);
 			break;
-		case 'P': c_sym_name_prefix = optarg; break;
-		case 'i': invert_formula = 1; break;
+		case 'P': o.c_sym_name_prefix = optarg; break;
+		case 'i': o.invert_formula = 1; break;
 		case 'C': display_cache = 1; break;
-		case 'H': extern_c_header = optarg; break;
+		case 'H': o.extern_c_header = optarg; break;
 		case ':':
 		case '?': usage(1); break;
 		}
 
-	if(!ltl_file == !add_ltl || argc != optind)
+	if(!!ltl_file + !!add_ltl + !!batch_file + server != 1 || argc != optind)
+		usage(1);
+	if (!batch_file && (o.sep != '\n' || n_workers != 1))
 		usage(1);
+	if (n_workers < 1 || (n_workers > 1 && display_cache))
+		usage(1);
+
+	if (server)
+	{
+		Symtab symtab; /* shared by all requests */
+		int nr = 0, r = 0;
+		memset(&symtab, 0, sizeof(symtab));
+		if (serve_path)
+			r = serve_socket(serve_path, &o, symtab, &nr);
+		else
+			serve(stdin, stdout, &o, symtab, &nr);
+		free(uform);
+		if (o.flags & LTL2BA_STATS)
+			tl_endstats();
+		if (display_cache)
+			cache_dump();
+		return r;
+	}
+
+	if (batch_file)
+	{
+		FILE *f = strcmp(batch_file, "-") ? fopen(batch_file, "r") : stdin;
+		if (!f)
+		{
+			fprintf(stderr, "%s: cannot open %s\n", progname, batch_file);
+			alldone(1);
+		}
+		int failed = n_workers > 1 ? batch_parallel(f, &o, n_workers)
+		                           : batch(f, &o);
+		if (f != stdin)
+			fclose(f);
+		free(uform);
+		if (display_cache)
+			cache_dump();
+		return failed != 0;
+	}
 
 	if (ltl_file)
 	{
@@ -254,7 +879,7 @@ int main(int argc, char *argv[])
 		add_ltl = formula;
 	}
 
-	if (invert_formula) {
+	if (o.invert_formula) {
 		inv_formula = emalloc(strlen(add_ltl) + 4);
 		if (!inv_formula)
 			fatal("not enough memory to invert formula");
@@ -262,10 +887,13 @@ int main(int argc, char *argv[])
 		add_ltl = inv_formula;
 	}
 
-	tl_main(add_ltl, outmode, flags, c_sym_name_prefix, extern_c_header);
+	Symtab symtab;
+	memset(&symtab, 0, sizeof(symtab));
+	tl_main(add_ltl, stdout, stderr, &o, symtab, 0);
 
 	free(formula);
 	free(inv_formula);
+	free(uform);
 
 	if (display_cache)
 		cache_dump();
@@ -322,7 +950,7 @@ void dump(FILE *f, const Node *n)
 		fprintf(f, " D ");
 		break;
 	default:
-		fprintf(stderr,"Unknown token: ");
+		fprintf(tl_err ? tl_err : stderr,"Unknown token: ");
 		tl_explain(n->ntyp);
 		break;
 	}
@@ -331,43 +959,46 @@ void dump(FILE *f, const Node *n)
 void
 tl_explain(int n)
 {
+	FILE *f = tl_err ? tl_err : stderr;
+
 	switch (n) {
-	case ALWAYS:	fprintf(stderr,"[]"); break;
-	case EVENTUALLY: fprintf(stderr,"<>"); break;
-	case IMPLIES:	fprintf(stderr,"->"); break;
-	case EQUIV:	fprintf(stderr,"<->"); break;
-	case PREDICATE:	fprintf(stderr,"predicate"); break;
-	case OR:	fprintf(stderr,"||"); break;
-	case AND:	fprintf(stderr,"&&"); break;
-	case NOT:	fprintf(stderr,"!"); break;
-	case U_OPER:	fprintf(stderr,"U"); break;
-	case V_OPER:	fprintf(stderr,"V"); break;
-	case NEXT:	fprintf(stderr,"X"); break;
-	case TRUE:	fprintf(stderr,"true"); break;
-	case FALSE:	fprintf(stderr,"false"); break;
-	case ';':	fprintf(stderr,"end of formula"); break;
-	default:	fprintf(stderr,"%c", n); break;
+	case ALWAYS:	fprintf(f,"[]"); break;
+	case EVENTUALLY: fprintf(f,"<>"); break;
+	case IMPLIES:	fprintf(f,"->"); break;
+	case EQUIV:	fprintf(f,"<->"); break;
+	case PREDICATE:	fprintf(f,"predicate"); break;
+	case OR:	fprintf(f,"||"); break;
+	case AND:	fprintf(f,"&&"); break;
+	case NOT:	fprintf(f,"!"); break;
+	case U_OPER:	fprintf(f,"U"); break;
+	case V_OPER:	fprintf(f,"V"); break;
+	case NEXT:	fprintf(f,"X"); break;
+	case TRUE:	fprintf(f,"true"); break;
+	case FALSE:	fprintf(f,"false"); break;
+	case ';':	fprintf(f,"end of formula"); break;
+	default:	fprintf(f,"%c", n); break;
 	}
 }
 
 static void
 non_fatal(int tl_yychar, const char *s1)
 {
+	FILE *f = tl_err ? tl_err : stderr;
 	int i;
 
-	fprintf(stderr, "%s: ", progname);
-	fputs(s1, stderr);
+	fprintf(f, "%s: ", progname);
+	fputs(s1, f);
 	if (tl_yychar != -1 && tl_yychar != 0)
-	{	fprintf(stderr,", saw '");
+	{	fprintf(f,", saw '");
 		tl_explain(tl_yychar);
-		fprintf(stderr,"'");
+		fprintf(f,"'");
 	}
-	fprintf(stderr,"\n%s: %s\n", progname, uform);
+	fprintf(f,"\n%s: %s\n", progname, uform);
 	int n = cnt + strlen(progname) + 2 - 1;
 	for (i = 0; i < n; i++)
-		fprintf(stderr,"-");
-	fprintf(stderr,"^\n");
-	fflush(stderr);
+		fprintf(f,"-");
+	fprintf(f,"^\n");
+	fflush(f);
 	tl_errs++;
 }
 
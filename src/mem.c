@@ -26,24 +26,24 @@
 #define FREE		2
 #define NREVENT		3
 
-static ATrans *atrans_list = (ATrans *)0;
-static GTrans *gtrans_list = (GTrans *)0;
-static BTrans *btrans_list = (BTrans *)0;
+static TL_THREAD_LOCAL ATrans *atrans_list = (ATrans *)0;
+static TL_THREAD_LOCAL GTrans *gtrans_list = (GTrans *)0;
+static TL_THREAD_LOCAL BTrans *btrans_list = (BTrans *)0;
 
-static int aallocs = 0, afrees = 0, apool = 0;
-static int gallocs = 0, gfrees = 0, gpool = 0;
-static int ballocs = 0, bfrees = 0, bpool = 0;
+static TL_THREAD_LOCAL int aallocs = 0, afrees = 0, apool = 0;
+static TL_THREAD_LOCAL int gallocs = 0, gfrees = 0, gpool = 0;
+static TL_THREAD_LOCAL int ballocs = 0, bfrees = 0, bpool = 0;
 
-static unsigned long All_Mem = 0;
+static TL_THREAD_LOCAL unsigned long All_Mem = 0;
 
 union M {
 	long size;
 	union M *link;
 };
 
-static union M *freelist[A_LARGE];
-static long	req[A_LARGE];
-static long	event[NREVENT][A_LARGE];
+static TL_THREAD_LOCAL union M *freelist[A_LARGE];
+static TL_THREAD_LOCAL long	req[A_LARGE];
+static TL_THREAD_LOCAL long	event[NREVENT][A_LARGE];
 
 void *
 tl_emalloc(int U)
@@ -172,6 +172,18 @@ void free_gtrans(GTrans *t, GTrans *sentinel, int fly) {
   gtrans_list = t;
 }
 
+void free_all_gtrans() {
+  GTrans *t;
+  while(gtrans_list) {
+    t = gtrans_list;
+    gtrans_list = t->nxt;
+    tfree(t->pos);
+    tfree(t->neg);
+    tfree(t->final);
+    tfree(t);
+  }
+}
+
 BTrans* emalloc_btrans(int sym_size) {
   BTrans *result;
   if(!btrans_list) {
@@ -198,6 +210,17 @@ void free_btrans(BTrans *t, BTrans *sentinel, int fly) {
   btrans_list = t;
 }
 
+void free_all_btrans() {
+  BTrans *t;
+  while(btrans_list) {
+    t = btrans_list;
+    btrans_list = t->nxt;
+    tfree(t->pos);
+    tfree(t->neg);
+    tfree(t);
+  }
+}
+
 void a_stats(void)
 {
 	long p, a, f;
@@ -416,68 +416,45 @@ bin_minimal(Symtab symtab, Node *ptr)
 	return ptr;
 }
 
+/* applies the unary operator 'tok' (NOT, ALWAYS, EVENTUALLY or NEXT) to ptr */
 static Node *
-tl_factor(Symtab symtab, Cexprtab *cexpr, Lexer *lex, Flags flags)
-{	Node *ptr = NULL;
-
-	switch (lex->tl_yychar) {
-	case '(':
-		ptr = tl_formula(symtab, cexpr, lex, flags);
-		if (lex->tl_yychar != ')')
-			tl_yyerror(lex, "expected ')'");
-		lex->tl_yychar = tl_yylex(symtab, cexpr, lex);
-		goto simpl;
+tl_unary(Symtab symtab, Flags flags, int tok, Node *ptr)
+{
+	switch (tok) {
 	case NOT:
-		ptr = lex->tl_yylval;
-		lex->tl_yychar = tl_yylex(symtab, cexpr, lex);
-		ptr->lft = tl_factor(symtab, cexpr, lex, flags);
-		ptr = push_negation(symtab, ptr);
-		goto simpl;
+		ptr = push_negation(symtab, tl_nn(NOT, ptr, NULL));
+		break;
 	case ALWAYS:
-		lex->tl_yychar = tl_yylex(symtab, cexpr, lex);
-
-		ptr = tl_factor(symtab, cexpr, lex, flags);
-
 		if(flags & LTL2BA_SIMP_LOG) {
 		  if (ptr->ntyp == FALSE
 		      ||  ptr->ntyp == TRUE)
-		    break;	/* [] false == false */
+		    return ptr;	/* [] false == false */
 
 		  if (ptr->ntyp == V_OPER)
 		    {	if (ptr->lft->ntyp == FALSE)
-		      break;	/* [][]p = []p */
+		      return ptr;	/* [][]p = []p */
 
 		    ptr = ptr->rgt;	/* [] (p V q) = [] q */
 		    }
 		}
 
 		ptr = tl_nn(V_OPER, False, ptr);
-		goto simpl;
-
+		break;
 	case NEXT:
-		lex->tl_yychar = tl_yylex(symtab, cexpr, lex);
-
-		ptr = tl_factor(symtab, cexpr, lex, flags);
-
 		if ((ptr->ntyp == TRUE || ptr->ntyp == FALSE)&& (flags & LTL2BA_SIMP_LOG))
-			break;	/* X true = true , X false = false */
+			return ptr;	/* X true = true , X false = false */
 
 		ptr = tl_nn(NEXT, ptr, NULL);
-		goto simpl;
-
+		break;
 	case EVENTUALLY:
-		lex->tl_yychar = tl_yylex(symtab, cexpr, lex);
-
-		ptr = tl_factor(symtab, cexpr, lex, flags);
-
 		if(flags & LTL2BA_SIMP_LOG) {
 		  if (ptr->ntyp == TRUE
 		      ||  ptr->ntyp == FALSE)
-		    break;	/* <> true == true */
+		    return ptr;	/* <> true == true */
 
 		  if (ptr->ntyp == U_OPER
 		      &&  ptr->lft->ntyp == TRUE)
-		    break;	/* <><>p = <>p */
+		    return ptr;	/* <><>p = <>p */
 
 		  if (ptr->ntyp == U_OPER)
 		    {	/* <> (p U q) = <> q */
@@ -487,10 +464,44 @@ tl_factor(Symtab symtab, Cexprtab *cexpr, Lexer *lex, Flags flags)
 		}
 
 		ptr = tl_nn(U_OPER, True, ptr);
-	simpl:
+		break;
+	}
+	if (flags & LTL2BA_SIMP_LOG)
+	  ptr = bin_simpler(symtab, ptr);
+	return ptr;
+}
+
+/* simplifies the binary operator node ptr */
+static Node *
+tl_binary(Symtab symtab, Flags flags, Node *ptr)
+{
+	if (flags & LTL2BA_SIMP_LOG)
+		return bin_simpler(symtab, ptr);
+	return bin_minimal(symtab, ptr);
+}
+
+static Node *
+tl_factor(Symtab symtab, Cexprtab *cexpr, Lexer *lex, Flags flags)
+{	Node *ptr = NULL;
+	int tok;
+
+	switch (tok = lex->tl_yychar) {
+	case '(':
+		ptr = tl_formula(symtab, cexpr, lex, flags);
+		if (lex->tl_yychar != ')')
+			tl_yyerror(lex, "expected ')'");
+		lex->tl_yychar = tl_yylex(symtab, cexpr, lex);
 		if (flags & LTL2BA_SIMP_LOG)
 		  ptr = bin_simpler(symtab, ptr);
 		break;
+	case NOT:
+	case ALWAYS:
+	case NEXT:
+	case EVENTUALLY:
+		lex->tl_yychar = tl_yylex(symtab, cexpr, lex);
+		ptr = tl_factor(symtab, cexpr, lex, flags);
+		ptr = tl_unary(symtab, flags, tok, ptr);
+		break;
 	case PREDICATE:
 		ptr = lex->tl_yylval;
 		lex->tl_yychar = tl_yylex(symtab, cexpr, lex);
@@ -555,10 +566,7 @@ again:
 		else
 			head->lft = res;
 
-		if (flags & LTL2BA_SIMP_LOG)
-			head = bin_simpler(symtab, head);
-		else
-			head = bin_minimal(symtab, head);
+		head = tl_binary(symtab, flags, head);
 
 		if (assoc[nr] == RIGHT && bin)
 			bin->rgt = head;
@@ -589,3 +597,80 @@ Node * tl_parse(Symtab symtab, Cexprtab *cexpr, Flags flags)
 		tl_yyerror(&lex, "syntax error");
 	return f;
 }
+
+/* Building formulas without parsing, simplified as tl_parse() would do.
+ * Arguments are consumed. */
+
+ltl2ba_Node * ltl2ba_mk_true(void)
+{
+	return True;
+}
+
+ltl2ba_Node * ltl2ba_mk_false(void)
+{
+	return False;
+}
+
+ltl2ba_Node * ltl2ba_mk_pred(Symtab symtab, const char *name)
+{
+	Node *n = tl_nn(PREDICATE, NULL, NULL);
+	n->sym = tl_lookup(symtab, name);
+	return n;
+}
+
+ltl2ba_Node * ltl2ba_mk_cexpr(Symtab symtab, Cexprtab *cexpr, const char *expr)
+{
+	char buffer[64];
+	sprintf(buffer, "_ltl2ba_cexpr_%d_status", cexpr_lookup(cexpr, expr));
+	return ltl2ba_mk_pred(symtab, buffer);
+}
+
+ltl2ba_Node * ltl2ba_mk_not(Symtab symtab, Flags flags, Node *a)
+{
+	return tl_unary(symtab, flags, NOT, a);
+}
+
+ltl2ba_Node * ltl2ba_mk_next(Symtab symtab, Flags flags, Node *a)
+{
+	return tl_unary(symtab, flags, NEXT, a);
+}
+
+ltl2ba_Node * ltl2ba_mk_always(Symtab symtab, Flags flags, Node *a)
+{
+	return tl_unary(symtab, flags, ALWAYS, a);
+}
+
+ltl2ba_Node * ltl2ba_mk_eventually(Symtab symtab, Flags flags, Node *a)
+{
+	return tl_unary(symtab, flags, EVENTUALLY, a);
+}
+
+ltl2ba_Node * ltl2ba_mk_and(Symtab symtab, Flags flags, Node *a, Node *b)
+{
+	return tl_binary(symtab, flags, tl_nn(AND, a, b));
+}
+
+ltl2ba_Node * ltl2ba_mk_or(Symtab symtab, Flags flags, Node *a, Node *b)
+{
+	return tl_binary(symtab, flags, tl_nn(OR, a, b));
+}
+
+ltl2ba_Node * ltl2ba_mk_implies(Symtab symtab, Flags flags, Node *a, Node *b)
+{
+	return tl_binary(symtab, flags, tl_nn(IMPLIES, a, b));
+}
+
+ltl2ba_Node * ltl2ba_mk_equiv(Symtab symtab, Flags flags, Node *a, Node *b)
+{
+	return tl_binary(symtab, flags, tl_nn(EQUIV, a, b));
+}
+
+ltl2ba_Node * ltl2ba_mk_until(Symtab symtab, Flags flags, Node *a, Node *b)
+{
+	return tl_binary(symtab, flags, tl_nn(U_OPER, a, b));
+}
+
+ltl2ba_Node * ltl2ba_mk_release(Symtab symtab, Flags flags, Node *a, Node *b)
+{
+	return tl_binary(symtab, flags, tl_nn(V_OPER, a, b));
+}
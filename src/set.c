@@ -211,6 +211,23 @@ int empty_set(int *l, int size) /* tests if a set is the empty set */
   return !test;
 }
 
+int card_set(int *l, int size) /* returns the number of elements of a set */
+{
+  int i, n = 0;
+  for(i = 0; i < size; i++)
+    n += __builtin_popcount((unsigned)l[i]);
+  return n;
+}
+
+unsigned hash_set(int *l, int size) /* returns a hash of the set */
+{
+  unsigned h = 0;
+  int i;
+  for(i = 0; i < size; i++)
+    h = (h ^ (unsigned)l[i]) * 0x01000193u;
+  return h ^ (h >> 15);
+}
+
 int same_sets(int *l1, int *l2, int size) /* tests if two sets are identical */
 {
   int i, test = 1;